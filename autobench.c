@@ -1,9 +1,22 @@
 /* MIT licensed; see LICENSE.md */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+#include <errno.h>
+#include <math.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 #include <unistd.h>
+#if defined(__linux__)
+#include <sched.h>
+#endif
 
 static void print_help(FILE* f, const char* self) {
 #if defined(__arm__) || defined(__arm) || defined(__ARM__) || defined(__ARM) || defined(__aarch64__) || defined(_M_ARM64)
@@ -30,21 +43,86 @@ static void print_help(FILE* f, const char* self) {
   fprintf(f, "  -f, --format=FORMAT\n");
   fprintf(f, "      --aligned\n");
   fprintf(f, "      --assume-correct\n");
-  fprintf(f, "\nOptions for make:\n");
-  fprintf(f, "  -j\n");
+  fprintf(f, "      --handoff=N\n");
+  fprintf(f, "      --check-max=N\n");
+  fprintf(f, "\nRanking:\n");
+  fprintf(f, "      --objective=SIZE:WEIGHT,SIZE:WEIGHT,...\n");
+  fprintf(f, "      --objective=@FILE\n");
+  fprintf(f, "  Benchmark at each SIZE, then rank by mean time per call over the\n");
+  fprintf(f, "  weighted mix, e.g. --objective=256:60,4k:30,1m:10. A FILE is a trace\n");
+  fprintf(f, "  of call lengths, one per line, optionally followed by a count.\n");
+  fprintf(f, "      --crossover\n");
+  fprintf(f, "  Fit time = a + len / rate to each candidate across sizes (those of\n");
+  fprintf(f, "  --objective or -s, else powers of two from 16 to 1M), then report the\n");
+  fprintf(f, "  fastest candidate per length range, the crossover lengths with bounds,\n");
+  fprintf(f, "  and the corresponding ALGO/LEN/ALGO/... spec for ./generate.\n");
+  fprintf(f, "      --pareto\n");
+  fprintf(f, "  Report the candidates which are Pareto-optimal over throughput (at\n");
+  fprintf(f, "  the largest size), code size (of .text), and latency (at the smallest\n");
+  fprintf(f, "  size). Sizes are as per --crossover, except defaulting to 64,512k.\n");
+  fprintf(f, "      --chains\n");
+  fprintf(f, "  Keep the first phase of each ALGO, and try every follow-on of v4, v2\n");
+  fprintf(f, "  and/or v1, then s2 or s3 or neither, which the ISA can emit (e.g.\n");
+  fprintf(f, "  v4s3x3 becomes v4s3x3, v4s3x3_v1, v4s3x3_v2_s3, ...).\n");
+  fprintf(f, "  Each chain is scored on lengths spread evenly over the residues modulo\n");
+  fprintf(f, "  the first phase's block size, as those are what follow-on phases see.\n");
+  fprintf(f, "      --align=N,N,...\n");
+  fprintf(f, "  Build each candidate once per N, with N nops ahead of the body of\n");
+  fprintf(f, "  crc32_impl and no loop alignment, so that its code lands at various\n");
+  fprintf(f, "  offsets within 64-byte blocks (default, with no =: 0,16,32,48). Then\n");
+  fprintf(f, "  report each candidate's range of throughput (at the largest size)\n");
+  fprintf(f, "  over these placements, ranked by its worst, and the flags to pin the\n");
+  fprintf(f, "  winner's best.\n");
+  fprintf(f, "      --suite\n");
+  fprintf(f, "  Build the third_party baselines which the host can run, benchmark\n");
+  fprintf(f, "  them next to the equivalents in README.md (at 4k,64k,512k,32m unless\n");
+  fprintf(f, "  -s is given), and print README-style tables with speedups. This\n");
+  fprintf(f, "  replaces any -i/-p/-a options, and is for x86_64 Linux only.\n");
+  fprintf(f, "\nTuning database:\n");
+  fprintf(f, "      --db=FILE  (default: autobench_db.tsv)\n");
+  fprintf(f, "      --query=json|header\n");
+  fprintf(f, "  Every benchmark result is appended to the database, along with a\n");
+  fprintf(f, "  fingerprint of the CPU and compiler. --query prints, rather than\n");
+  fprintf(f, "  running anything, the best ./generate arguments recorded for each\n");
+  fprintf(f, "  (CPU, polynomial, size class, compiler).\n");
+  fprintf(f, "\nOptions for compilation:\n");
+  fprintf(f, "  -jN    run N compile workers (default: one per CPU not used by ./bench)\n");
+  fprintf(f, "  --bench-jobs=N\n");
+  fprintf(f, "         run N ./bench workers (default: 1), each on its own physical core\n");
+  fprintf(f, "         with SMT siblings idle; results are normalised against a reference\n");
+  fprintf(f, "         kernel which every worker re-measures periodically\n");
+  fprintf(f, "      --cc=CC,CC,...  build every candidate with each of these compilers\n");
+  fprintf(f, "      --cflags=FLAGS  build with FLAGS in place of CCOPT; can be repeated,\n");
+  fprintf(f, "                      in which case every candidate is built with each\n");
+  fprintf(f, "  The CC and CCOPT environment variables are respected. When --cc or\n");
+  fprintf(f, "  --cflags is given, the compiler or flags are appended to result names.\n");
+  fprintf(f, "\nBuilds are cached in ab_cache/, and results in ab_journal.txt, so\n");
+  fprintf(f, "an interrupted run can be resumed by running the same command again.\n");
+  fprintf(f, "      --fresh  benchmark everything again, ignoring previous results\n");
   fprintf(f, "\nSee https://github.com/corsix/fast-crc32/\n");
 }
 
 #define FATAL(fmt, ...) \
   (fprintf(stderr, "FATAL error at %s:%d - " fmt "\n", __FILE__, __LINE__, ## __VA_ARGS__), fflush(stderr), exit(1))
 
-static const char* g_makefile_path = "ab_Makefile";
 static int g_samples_mode = 0;
+static int g_jobs = 0;
+static int g_bench_jobs = 1;
+static const char* g_sep = ": ";
 
 typedef struct impl_t {
   char* name;
   char* arguments;
   int original_order;
+  const char* cc; /* NULL for g_cc. */
+  const char* ccopt; /* NULL for g_ccopt. */
+  double score; /* Mean ns per call over the --objective mix, or < 0. */
+  double* rates; /* GB/s at each of g_sizes, or NULL. */
+  struct chain_group_t* chain; /* For --chains, the first phase being extended. */
+  int prebuilt; /* If set, NAME.so already exists, and is not ours to build. */
+  struct impl_t* placement_of; /* For --align, the candidate this is a padded build of. */
+  uint32_t padding; /* For --align, the number of nops. */
+  char key[17]; /* Build cache key, as hex. */
 } impl_t;
 
 typedef struct ptr_array_t {
@@ -67,21 +145,41 @@ static void ptr_array_append(ptr_array_t* arr, void* ptr) {
 }
 
 static ptr_array_t g_impls;
-static ptr_array_t g_make_args;
 static ptr_array_t g_bench_args;
+static int g_fresh = 0;
+static const char* g_objective = NULL;
+static const char* g_query = NULL;
+static const char* g_db_path = "autobench_db.tsv";
+static int g_crossover = 0;
+static int g_pareto = 0;
+static int g_chains = 0;
+static int g_suite = 0;
+static const char* g_cc_list = NULL;
+static ptr_array_t g_cflags_list;
+static const char* g_align_list = NULL;
 
 static void create_impl(const char* isa, const char* poly, const char* algo) {
   size_t sz = sizeof(impl_t) + (strlen(isa) + strlen(poly) + strlen(algo)) * 2 + 32;
   impl_t* impl = (impl_t*)malloc(sz);
+  char* slash;
   int n;
   impl->name = (char*)(impl + 1);
   n = sprintf(impl->name, "%s_%s_%s_%s", g_samples_mode ? "sample" : "ab", isa, poly, algo);
+  for (slash = impl->name; (slash = strchr(slash, '/')); ) *slash = '-'; /* Dispatching ALGO. */
   impl->arguments = impl->name + n + 1;
   n = 0;
   if (*isa) n += sprintf(impl->arguments + n, " -i %s", isa);
   if (*poly) n += sprintf(impl->arguments + n, " -p %s", poly);
   if (*algo) n += sprintf(impl->arguments + n, " -a %s", algo);
   impl->original_order = (int)g_impls.size;
+  impl->cc = NULL;
+  impl->ccopt = NULL;
+  impl->score = -1.;
+  impl->rates = NULL;
+  impl->chain = NULL;
+  impl->prebuilt = 0;
+  impl->placement_of = NULL;
+  impl->padding = 0;
   ptr_array_append(&g_impls, (void*)impl);
 }
 
@@ -192,23 +290,63 @@ static void split_commas(const char* str, string_array_t* dst) {
   free(mut);
 }
 
+/* What each ./generate ISA can emit, for --chains: the bytes per vector */
+/* step (0 if there are no vector phases), the bytes per scalar step, and */
+/* whether phases may have more than one scalar accumulator. */
+
+typedef struct isa_shape_t {
+  const char* isa;
+  uint32_t vector_bytes;
+  uint32_t scalar_bytes;
+  int multi_scalar;
+} isa_shape_t;
+
+static const isa_shape_t g_isa_shapes[] = {
+  {"none", 0, 4, 0}, {"neon", 16, 8, 1}, {"neon_eor3", 16, 8, 1},
+  {"sse", 16, 8, 1}, {"avx", 16, 8, 1}, {"avx2", 16, 8, 1}, {"avx512", 16, 8, 1},
+  {"avx512_vpclmulqdq", 64, 8, 1}, {"avx512_vpclmulqdq_gfni", 64, 8, 1}
+};
+
+static const isa_shape_t* isa_shape(const char* isa) {
+  size_t i;
+  for (i = 0; i < sizeof(g_isa_shapes) / sizeof(g_isa_shapes[0]); ++i) {
+    if (!strcmp(g_isa_shapes[i].isa, isa)) return &g_isa_shapes[i];
+  }
+  FATAL("--chains doesn't know the shape of ISA %s", isa);
+}
+
+static int is_crc32c(const char* poly) {
+  /* As per ./generate's parse_poly: a name, or the polynomial in hex. */
+  char* end;
+  unsigned long long value;
+  if (!strcmp(poly, "crc32c") || !strcmp(poly, "CRC32C")) return 1;
+  value = strtoull(poly, &end, 16);
+  return end != poly && !*end && (value == 0x1EDC6F41ull || value == 0x11EDC6F41ull);
+}
+
 static void create_impls(const char* isa, const char* poly, const char* algo) {
-  string_array_t sa = {};
+  string_array_t sa = {0};
   uint32_t isa_end, poly_end, algo_end, isa_itr, poly_itr, algo_itr;
+  int has_vpclmulqdq = 0;
   if (isa && !strcmp(isa, "native")) {
 #if defined(__arm__) || defined(__arm) || defined(__ARM__) || defined(__ARM) || defined(__aarch64__) || defined(_M_ARM64)
     isa = "neon,neon_eor3";
 #else
-    isa = "sse,avx512,avx512_vpclmulqdq";
+    isa = "sse,avx512,avx512_vpclmulqdq,avx512_vpclmulqdq_gfni";
 #endif
   }
   split_commas(isa, &sa), isa_end = sa.string_count;
   split_commas(poly, &sa), poly_end = sa.string_count;
   split_commas(algo, &sa), algo_end = sa.string_count;
+  for (isa_itr = 0; isa_itr < isa_end; ++isa_itr) {
+    if (!strcmp(sa.data + sa.offsets[isa_itr], "avx512_vpclmulqdq")) has_vpclmulqdq = 1;
+  }
   for (isa_itr = 0; isa_itr < isa_end; ++isa_itr) {
     char* isa_val = sa.data + sa.offsets[isa_itr];
     for (poly_itr = isa_end; poly_itr < poly_end; ++poly_itr) {
       char* poly_val = sa.data + sa.offsets[poly_itr];
+      /* ./generate ignores gfni for crc32c, so it would be the same code again. */
+      if (has_vpclmulqdq && !strcmp(isa_val, "avx512_vpclmulqdq_gfni") && is_crc32c(poly_val)) continue;
       for (algo_itr = poly_end; algo_itr < algo_end; ++algo_itr) {
         char* algo_val = sa.data + sa.offsets[algo_itr];
         create_impl(isa_val, poly_val, algo_val);
@@ -217,6 +355,176 @@ static void create_impls(const char* isa, const char* poly, const char* algo) {
   }
 }
 
+static size_t append_name_part(char* dst, const char* src) {
+  /* Append "_SRC" to a name, with SRC reduced to characters safe in file names. */
+  size_t n = 0;
+  const char* slash = strrchr(src, '/');
+  if (slash && !strchr(src, ' ')) src = slash + 1; /* Path to a compiler. */
+  dst[n++] = '_';
+  for (;;) {
+    char c;
+    while (*src == ' ' || *src == '-') ++src;
+    if (!*src) break;
+    if (dst[n - 1] != '_') dst[n++] = '-';
+    while ((c = *src) && c != ' ') {
+      int safe = ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || ('0' <= c && c <= '9') || c == '.' || c == '+';
+      dst[n++] = safe ? c : '-';
+      ++src;
+    }
+  }
+  dst[n] = '\0';
+  return n;
+}
+
+static void create_compiler_variants(void) {
+  /* Expand every impl into one per (--cc, --cflags) pair. The compiler */
+  /* and flags only appear in names when the respective option is given. */
+  ptr_array_t bases = g_impls;
+  string_array_t ccs = {0};
+  uint32_t cc_itr, cc_count;
+  const char** cc_names;
+  size_t base_itr, flags_itr, flags_count = g_cflags_list.size ? g_cflags_list.size : 1;
+  if (!g_cc_list && !g_cflags_list.size) return;
+  if (g_samples_mode) return;
+  split_commas(g_cc_list, &ccs);
+  cc_count = g_cc_list ? ccs.string_count : 1;
+  /* One copy of each compiler, shared by all of its impls. */
+  cc_names = (const char**)malloc(cc_count * sizeof(const char*));
+  for (cc_itr = 0; cc_itr < cc_count; ++cc_itr) {
+    cc_names[cc_itr] = g_cc_list ? strdup(ccs.data + ccs.offsets[cc_itr]) : NULL;
+  }
+  memset(&g_impls, 0, sizeof(g_impls));
+  for (base_itr = 0; base_itr < bases.size; ++base_itr) {
+    impl_t* base = (impl_t*)bases.contents[base_itr];
+    for (cc_itr = 0; cc_itr < cc_count; ++cc_itr) {
+      const char* cc = cc_names[cc_itr];
+      for (flags_itr = 0; flags_itr < flags_count; ++flags_itr) {
+        const char* ccopt = g_cflags_list.size ? (const char*)g_cflags_list.contents[flags_itr] : NULL;
+        size_t name_len = strlen(base->name), args_len = strlen(base->arguments);
+        size_t sz = sizeof(impl_t) + name_len + args_len + (cc ? strlen(cc) : 0) + (ccopt ? strlen(ccopt) * 2 : 0) + 8;
+        impl_t* impl = (impl_t*)malloc(sz);
+        size_t n = name_len;
+        impl->name = (char*)(impl + 1);
+        memcpy(impl->name, base->name, name_len);
+        if (cc) n += append_name_part(impl->name + n, cc);
+        if (ccopt) n += append_name_part(impl->name + n, ccopt);
+        impl->name[n] = '\0';
+        impl->arguments = impl->name + n + 1;
+        memcpy(impl->arguments, base->arguments, args_len + 1);
+        impl->original_order = (int)g_impls.size;
+        impl->cc = cc;
+        impl->ccopt = ccopt;
+        impl->score = -1.;
+        impl->rates = NULL;
+        impl->chain = base->chain;
+        impl->prebuilt = 0;
+        impl->placement_of = NULL;
+        impl->padding = 0;
+        ptr_array_append(&g_impls, (void*)impl);
+      }
+    }
+    free(base);
+  }
+  free(bases.contents);
+  free(cc_names);
+  free(ccs.offsets);
+  free(ccs.data);
+}
+
+/* Fallback chains: every ALGO's first phase, followed by each tail which */
+/* the ISA can emit: a descending run of v4, v2 and v1 (any of them, or */
+/* none), then optionally s2 or s3. The implicit tail (one scalar step at a */
+/* time, then 1 byte at a time) always runs last, so the empty chain is */
+/* also a candidate. */
+
+static void chain_tails(string_array_t* tails, const isa_shape_t* shape) {
+  static const char* const scalars[] = {"", "_s2", "_s3"};
+  uint32_t vectors, i;
+  for (vectors = 0; vectors < (shape->vector_bytes ? 8u : 1u); ++vectors) {
+    for (i = 0; i < (shape->multi_scalar ? 3u : 1u); ++i) {
+      char tail[32];
+      sprintf(tail, "%s%s%s%s", vectors & 4 ? "_v4" : "", vectors & 2 ? "_v2" : "", vectors & 1 ? "_v1" : "", scalars[i]);
+      string_array_append(tails, tail);
+    }
+  }
+}
+
+typedef struct chain_group_t {
+  char* main; /* "-i ISA -p POLY -a PHASE" */
+  uint32_t modulus; /* Bytes consumed by one iteration of the first phase. */
+  uint32_t sizes[8]; /* Indices into g_sizes. */
+} chain_group_t;
+
+static uint32_t phase_modulus(const isa_shape_t* shape, const char* phase) {
+  /* Mirrors the block and kernel size logic of emit_main_fn in generate.c. */
+  uint32_t v_load = 0, s_load = 0, kernel = 0, block, align;
+  const char* itr = phase;
+  while (*itr && *itr != '_') {
+    char c = *itr++;
+    uint32_t n = 0, x = 1;
+    if (c != 'v' && c != 's' && c != 'k') continue;
+    while ('0' <= *itr && *itr <= '9') n = n * 10 + (*itr++ - '0');
+    if (*itr == 'x' && c != 'k') {
+      for (x = 0, ++itr; '0' <= *itr && *itr <= '9'; ) x = x * 10 + (*itr++ - '0');
+    }
+    if (c == 'v') v_load += n * x;
+    else if (c == 's') s_load += n * x;
+    else kernel = n;
+  }
+  if (!v_load && !s_load) s_load = 1;
+  if (v_load && !shape->vector_bytes) FATAL("--chains: ISA %s has no vector phases, so can't extend %s", shape->isa, phase);
+  block = v_load * shape->vector_bytes + s_load * shape->scalar_bytes;
+  align = v_load ? shape->vector_bytes : shape->scalar_bytes;
+  if (kernel / align * align / block) return kernel / align * align / block * block;
+  return block;
+}
+
+static void create_chain_variants(void) {
+  ptr_array_t bases = g_impls;
+  ptr_array_t groups = {0};
+  size_t base_itr, i;
+  if (!g_chains || g_samples_mode) return;
+  memset(&g_impls, 0, sizeof(g_impls));
+  for (base_itr = 0; base_itr < bases.size; ++base_itr) {
+    impl_t* base = (impl_t*)bases.contents[base_itr];
+    const char* args = base->arguments;
+    const char* a = strstr(args, " -a ");
+    const char* isa = strstr(args, " -i ");
+    const char* poly = strstr(args, " -p ");
+    char isa_buf[64], poly_buf[64], phase[256];
+    chain_group_t* group = NULL;
+    if (!a || !isa) FATAL("--chains needs an ISA and an ALGO");
+    snprintf(isa_buf, sizeof(isa_buf), "%.*s", (int)strcspn(isa + 4, " "), isa + 4);
+    snprintf(poly_buf, sizeof(poly_buf), "%.*s", poly ? (int)strcspn(poly + 4, " ") : 0, poly ? poly + 4 : "");
+    snprintf(phase, sizeof(phase), "%.*s", (int)strcspn(a + 4, "_/"), a + 4);
+    for (i = 0; i < groups.size; ++i) {
+      chain_group_t* g = (chain_group_t*)groups.contents[i];
+      if (!strncmp(g->main, args, (size_t)(a - args)) && !strcmp(g->main + (a - args) + 4, phase)) group = g;
+    }
+    if (!group) {
+      string_array_t tails = {0};
+      const isa_shape_t* shape = isa_shape(isa_buf);
+      group = (chain_group_t*)calloc(1, sizeof(chain_group_t));
+      group->main = (char*)malloc(strlen(args) + 1);
+      sprintf(group->main, "%.*s -a %s", (int)(a - args), args, phase);
+      group->modulus = phase_modulus(shape, phase);
+      ptr_array_append(&groups, (void*)group);
+      chain_tails(&tails, shape);
+      for (i = 0; i < tails.string_count; ++i) {
+        char algo[300];
+        snprintf(algo, sizeof(algo), "%s%s", phase, tails.data + tails.offsets[i]);
+        create_impl(isa_buf, poly_buf, algo);
+        ((impl_t*)g_impls.contents[g_impls.size - 1])->chain = group;
+      }
+      free(tails.offsets);
+      free(tails.data);
+    }
+    free(base);
+  }
+  free(bases.contents);
+  free(groups.contents);
+}
+
 typedef struct cli_arg_t {
   const char* const* spellings;
   const char* value;
@@ -245,6 +553,7 @@ static cli_arg_t* match_arg(cli_arg_t** args, const char* str, size_t n) {
 
 static void parse_args(int argc, const char* const* argv) {
   int bench_arg = -1; /* Arbitrary sentinel. */
+  int cc_arg = -2; /* Arbitrary sentinel. */
 #define ARGS \
   DEF_ARG(0, isa, "-i") \
   DEF_ARG(0, poly, "-p", "--polynomial") \
@@ -252,7 +561,11 @@ static void parse_args(int argc, const char* const* argv) {
   DEF_ARG(bench_arg, duration, "-d") \
   DEF_ARG(bench_arg, size, "-s") \
   DEF_ARG(bench_arg, rounds, "-r") \
-  DEF_ARG(bench_arg, format, "-f")
+  DEF_ARG(bench_arg, format, "-f") \
+  DEF_ARG(bench_arg, handoff, "--handoff") \
+  DEF_ARG(bench_arg, check_max, "--check-max") \
+  DEF_ARG(cc_arg, cc, "--cc") \
+  DEF_ARG(cc_arg, cflags, "--cflags")
 #define DEF_ARG(init, name, ...) static const char* name##_spellings[] = {"--" #name, __VA_ARGS__, NULL};
   ARGS
 #undef DEF_ARG
@@ -270,20 +583,58 @@ static void parse_args(int argc, const char* const* argv) {
       print_help(stdout, argv[0]);
       exit(0);
     } else if (arg[0] == '-' && arg[1] == 'j') {
-      ptr_array_append(&g_make_args, (void*)arg);
+      g_jobs = atoi(arg + 2);
+    } else if (!strncmp(arg, "--bench-jobs=", 13)) {
+      g_bench_jobs = atoi(arg + 13);
+      if (g_bench_jobs < 1 || g_bench_jobs > 1024) FATAL("bad value for %s", arg);
     } else if (!strcmp(arg, "--assume-correct") || !strcmp(arg, "--aligned")) {
       ptr_array_append(&g_bench_args, (void*)arg);
     } else if (!strcmp(arg, "--samples")) {
       g_samples_mode = 1;
+    } else if (!strcmp(arg, "--fresh")) {
+      g_fresh = 1;
+    } else if (!strncmp(arg, "--objective=", 12)) {
+      g_objective = arg + 12;
+    } else if (!strncmp(arg, "--query=", 8)) {
+      g_query = arg + 8;
+    } else if (!strncmp(arg, "--db=", 5)) {
+      g_db_path = arg + 5;
+    } else if (!strcmp(arg, "--suite")) {
+      g_suite = 1;
+    } else if (!strcmp(arg, "--chains")) {
+      g_chains = 1;
+    } else if (!strcmp(arg, "--pareto")) {
+      g_pareto = 1;
+    } else if (!strcmp(arg, "--crossover")) {
+      g_crossover = 1;
+    } else if (!strcmp(arg, "--align")) {
+      g_align_list = "0,16,32,48";
+    } else if (!strncmp(arg, "--align=", 8)) {
+      g_align_list = arg + 8;
+    } else if (!strcmp(arg, "--objective")) {
+      if (++i >= argc) FATAL("missing value for option %s", arg);
+      g_objective = argv[i];
     } else {
       const char* eq = strchr(arg, '=');
       size_t n = eq ? (size_t)(eq - arg) : strlen(arg);
       cli_arg_t* m = match_arg(args, arg, n);
       if (m) {
-        if (m->used == bench_arg) {
+        if (m->used == cc_arg) {
+          const char* value = eq ? eq + 1 : ++i < argc ? argv[i] : NULL;
+          if (!value) FATAL("missing value for option %.*s", (int)n, arg);
+          if (m == &cc) {
+            g_cc_list = value;
+          } else {
+            ptr_array_append(&g_cflags_list, (void*)value);
+          }
+        } else if (m->used == bench_arg) {
+          const char* value = eq ? eq + 1 : NULL;
           ptr_array_append(&g_bench_args, (void*)arg);
           if (!eq && ++i < argc) {
-            ptr_array_append(&g_bench_args, (void*)argv[i]);
+            ptr_array_append(&g_bench_args, (void*)(value = argv[i]));
+          }
+          if (m == &format && value) {
+            g_sep = strcmp(value, "csv") ? ": " : ",";
           }
         } else {
           if (m->value && !m->used) {
@@ -347,118 +698,1651 @@ static void deduplicate_impls(void) {
   qsort(g_impls.contents, g_impls.size, sizeof(void*), cmp_impl_original_order);
 }
 
-static void generate_makefile(void) {
-  size_t i, j;
+/* Compiling and benchmarking, as a pipeline. */
+/* Up to g_jobs compile workers run at once, whilst a single ./bench process */
+/* (pinned to its own CPU) benchmarks each candidate as soon as it is built. */
+
 #if defined(__MACH__) && defined(__APPLE__)
-  const char* so_suffix = ".dylib";
-  const char* cc_shared = "-dynamiclib";
+static const char* g_so_suffix = ".dylib";
+static const char* g_cc_shared = "-dynamiclib";
 #else
-  const char* so_suffix = ".so";
-  const char* cc_shared = "-shared";
+static const char* g_so_suffix = ".so";
+static const char* g_cc_shared = "-shared";
+#endif
+
+static const char* g_cc = "gcc";
+static const char* g_ccopt = "-O3 -Wall -Wextra -Wshadow -march=native";
+
+static const char* isa_cc_flags(const char* arguments) {
+  if (strstr(arguments, "-i avx512_vpclmulqdq_gfni")) return " -msse4.2 -mpclmul -mavx512f -mavx512vl -mavx512bw -mavx512vbmi -mvpclmulqdq -mgfni";
+  if (strstr(arguments, "-i avx512_vpclmulqdq")) return " -msse4.2 -mpclmul -mavx512f -mavx512vl -mvpclmulqdq";
+  if (strstr(arguments, "-i avx512")) return " -msse4.2 -mpclmul -mavx512f -mavx512vl";
+  if (strstr(arguments, "-i avx") || strstr(arguments, "-i sse")) return " -msse4.2 -mpclmul";
+#if !(defined(__MACH__) && defined(__APPLE__))
+  if (strstr(arguments, "-i neon_eor3")) return " -march=armv8.2-a+crypto+sha3";
+  if (strstr(arguments, "-i neon")) return " -march=armv8-a+crypto+crc";
+#endif
+  return "";
+}
+
+static char* compile_prefix(impl_t* impl) {
+  /* The compiler invocation for one candidate, minus input and output. */
+  const char* isa_flags = isa_cc_flags(impl->arguments);
+  const char* cc = impl->cc ? impl->cc : g_cc;
+  const char* ccopt = impl->ccopt ? impl->ccopt : g_ccopt;
+  char* cmd = (char*)malloc(strlen(cc) + strlen(ccopt) + strlen(g_cc_shared) + strlen(isa_flags) + 4);
+  sprintf(cmd, "%s %s %s%s", cc, ccopt, g_cc_shared, isa_flags);
+  return cmd;
+}
+
+#define ALIGN_FLAGS " -falign-functions=64 -falign-loops=1 -falign-jumps=1 -fpatchable-function-entry="
+
+static void create_align_variants(void) {
+  /* Expand every impl into one per --align padding. Loops are left */
+  /* unaligned, so that the padding moves all of crc32_impl's code. */
+  ptr_array_t bases = g_impls;
+  string_array_t pads = {0};
+  size_t base_itr;
+  uint32_t pad_itr;
+  if (!g_align_list || g_samples_mode) return;
+  split_commas(g_align_list, &pads);
+  memset(&g_impls, 0, sizeof(g_impls));
+  for (base_itr = 0; base_itr < bases.size; ++base_itr) {
+    impl_t* base = (impl_t*)bases.contents[base_itr];
+    if (base->prebuilt) {
+      base->original_order = (int)g_impls.size;
+      ptr_array_append(&g_impls, (void*)base);
+      continue;
+    }
+    for (pad_itr = 0; pad_itr < pads.string_count; ++pad_itr) {
+      const char* pad = pads.data + pads.offsets[pad_itr];
+      const char* ccopt = base->ccopt ? base->ccopt : g_ccopt;
+      size_t args_len = strlen(base->arguments);
+      impl_t* impl = (impl_t*)malloc(sizeof(impl_t) + strlen(base->name) + args_len + strlen(pad) + 8);
+      char* flags = (char*)malloc(strlen(ccopt) + sizeof(ALIGN_FLAGS) + strlen(pad));
+      char* end;
+      int n;
+      *impl = *base;
+      impl->padding = (uint32_t)strtoul(pad, &end, 10);
+      if (end == pad || *end) FATAL("bad padding %s in --align", pad);
+      sprintf(flags, "%s" ALIGN_FLAGS "%u", ccopt, impl->padding);
+      impl->name = (char*)(impl + 1);
+      n = sprintf(impl->name, "%s_pad%u", base->name, impl->padding);
+      impl->arguments = impl->name + n + 1;
+      memcpy(impl->arguments, base->arguments, args_len + 1);
+      impl->original_order = (int)g_impls.size;
+      impl->ccopt = flags;
+      impl->placement_of = base; /* Kept, but only for its name. */
+      ptr_array_append(&g_impls, (void*)impl);
+    }
+  }
+  free(bases.contents);
+  free(pads.offsets);
+  free(pads.data);
+}
+
+/* Content-addressed build cache, and journal of benchmark results. */
+/* A candidate's key covers generate.c, its arguments, and the compiler (its */
+/* identity and flags), so ab_cache/KEY.so can be reused across runs. The */
+/* journal maps candidate key plus bench key (bench.c, crc32_runtime.*, and */
+/* its arguments) to the line that bench printed, so an interrupted sweep */
+/* resumes in place. */
+
+static const char* g_cache_dir = "ab_cache";
+static const char* g_journal_path = "ab_journal.txt";
+static string_array_t g_journal;
+static uint64_t g_bench_key;
+static const char* const g_runtime_deps[] = {"crc32_runtime.c", "crc32_runtime.h", NULL}; /* Linked into bench. */
+
+#define FNV1A_INIT 0xcbf29ce484222325ull
+
+static uint64_t fnv1a(uint64_t h, const void* data, size_t n) {
+  const unsigned char* p = (const unsigned char*)data;
+  while (n--) {
+    h = (h ^ *p++) * 0x100000001b3ull;
+  }
+  return h;
+}
+
+static uint64_t fnv1a_str(uint64_t h, const char* str) {
+  return fnv1a(h, str, strlen(str) + 1);
+}
+
+static uint64_t hash_stream(uint64_t h, FILE* f) {
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f))) {
+    h = fnv1a(h, buf, n);
+  }
+  return h;
+}
+
+static uint64_t hash_file(uint64_t h, const char* path, const char* fallback_path) {
+  FILE* f = fopen(path, "rb");
+  if (!f && fallback_path) f = fopen(path = fallback_path, "rb");
+  if (!f) FATAL("could not read %s", path);
+  h = hash_stream(h, f);
+  fclose(f);
+  return h;
+}
+
+static uint64_t compiler_identity(const char* prefix) {
+  /* Hash of what the compiler says it would do (version, target, */
+  /* and any -march=native expansion), memoised per distinct prefix. */
+  static string_array_t prefixes;
+  static uint64_t* hashes;
+  uint32_t i;
+  char* cmd;
+  FILE* f;
+  for (i = 0; i < prefixes.string_count; ++i) {
+    if (!strcmp(prefixes.data + prefixes.offsets[i], prefix)) return hashes[i];
+  }
+  cmd = (char*)malloc(strlen(prefix) + 64);
+  sprintf(cmd, "%s -### -x c -S -o /dev/null /dev/null 2>&1", prefix);
+  f = popen(cmd, "r");
+  if (!f) FATAL("could not run %s", cmd);
+  hashes = (uint64_t*)realloc(hashes, (i + 1) * sizeof(uint64_t));
+  hashes[i] = hash_stream(fnv1a_str(FNV1A_INIT, prefix), f);
+  pclose(f);
+  free(cmd);
+  string_array_append(&prefixes, prefix);
+  return hashes[i];
+}
+
+static void compute_keys(void) {
+  uint64_t base = hash_file(FNV1A_INIT, "generate.c", "generate");
+  size_t i;
+  g_bench_key = hash_file(FNV1A_INIT, "bench.c", "bench");
+  for (i = 0; g_runtime_deps[i]; ++i) g_bench_key = hash_file(g_bench_key, g_runtime_deps[i], "bench");
+  for (i = 0; i < g_bench_args.size; ++i) {
+    g_bench_key = fnv1a_str(g_bench_key, (const char*)g_bench_args.contents[i]);
+  }
+  for (i = 0; i < g_impls.size; ++i) {
+    impl_t* impl = (impl_t*)g_impls.contents[i];
+    uint64_t h = fnv1a_str(base, impl->arguments);
+    if (impl->prebuilt) {
+      char* path = (char*)malloc(strlen(impl->name) + strlen(g_so_suffix) + 1);
+      sprintf(path, "%s%s", impl->name, g_so_suffix);
+      h = hash_file(FNV1A_INIT, path, NULL);
+      free(path);
+    } else if (!g_samples_mode) {
+      char* prefix = compile_prefix(impl);
+      uint64_t id = compiler_identity(prefix);
+      h = fnv1a(h, &id, sizeof(id));
+      free(prefix);
+    }
+    sprintf(impl->key, "%016llx", (unsigned long long)h);
+  }
+}
+
+static int cmp_journal_entry(const void* lhs, const void* rhs) {
+  /* Entries are "KEY\tLINE"; compare just the KEY part. */
+  const char* l = g_journal.data + *(const uint32_t*)lhs;
+  const char* r = g_journal.data + *(const uint32_t*)rhs;
+  return strncmp(l, r, 32);
+}
+
+static void load_journal(void) {
+  char line[4096];
+  FILE* f = fopen(g_journal_path, "r");
+  if (!f) return;
+  while (fgets(line, sizeof(line), f)) {
+    size_t n = strlen(line);
+    if (n > 33 && line[32] == '\t' && line[n - 1] == '\n') {
+      line[n - 1] = '\0';
+      string_array_append(&g_journal, line);
+    }
+  }
+  fclose(f);
+  qsort(g_journal.offsets, g_journal.string_count, sizeof(uint32_t), cmp_journal_entry);
+}
+
+static void journal_key(char* dst, impl_t* impl) {
+  sprintf(dst, "%s%016llx", impl->key, (unsigned long long)g_bench_key);
+}
+
+static const char* journal_lookup(impl_t* impl) {
+  /* Returns a previously recorded result for this candidate, if any. */
+  uint32_t lo = 0, hi = g_journal.string_count;
+  char key[40];
+  journal_key(key, impl);
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    const char* entry = g_journal.data + g_journal.offsets[mid];
+    int cmp = strncmp(key, entry, 32);
+    if (cmp == 0) return entry + 33;
+    if (cmp < 0) hi = mid; else lo = mid + 1;
+  }
+  return NULL;
+}
+
+static char* journal_replay(impl_t* impl, const char* entry) {
+  /* The same build can be reached under another name (say, via the */
+  /* default compiler and via --cc), so put this candidate's name on it. */
+  const char* rates = strstr(entry, g_sep);
+  char* line;
+  rates = rates ? rates + strlen(g_sep) : entry;
+  line = (char*)malloc(strlen(impl->name) + strlen(g_so_suffix) + strlen(g_sep) + strlen(rates) + 1);
+  sprintf(line, "%s%s%s%s", impl->name, g_so_suffix, g_sep, rates);
+  return line;
+}
+
+static void journal_append(impl_t* impl, const char* line) {
+  static FILE* f = NULL;
+  char key[40];
+  if (!f && !(f = fopen(g_journal_path, "a"))) FATAL("could not open %s", g_journal_path);
+  journal_key(key, impl);
+  fprintf(f, "%s\t%s\n", key, line);
+  fflush(f);
+}
+
+static char* cache_path(impl_t* impl, const char* suffix) {
+  char* path = (char*)malloc(strlen(g_cache_dir) + strlen(impl->key) + strlen(suffix) + 2);
+  sprintf(path, "%s/%s%s", g_cache_dir, impl->key, suffix);
+  return path;
+}
+
+static int cache_has(impl_t* impl) {
+  struct stat st;
+  char* path;
+  int result;
+  if (impl->prebuilt) return 1;
+  path = cache_path(impl, g_samples_mode ? ".c" : g_so_suffix);
+  result = stat(path, &st) == 0;
+  free(path);
+  return result;
+}
+
+static void publish_file(impl_t* impl, const char* suffix) {
+  /* Make ab_NAME.SUFFIX refer to the cached ab_cache/KEY.SUFFIX. */
+  char* src = cache_path(impl, suffix);
+  char* dst = (char*)malloc(strlen(impl->name) + strlen(suffix) + 1);
+  sprintf(dst, "%s%s", impl->name, suffix);
+  unlink(dst);
+  if (link(src, dst) && symlink(src, dst)) FATAL("could not link %s to %s", dst, src);
+  free(src);
+  free(dst);
+}
+
+static void publish(impl_t* impl) {
+  if (impl->prebuilt) return;
+  publish_file(impl, ".c");
+  if (!g_samples_mode) publish_file(impl, g_so_suffix);
+}
+
+static char* build_command(impl_t* impl) {
+  /* Shell command to generate (and then compile) one candidate into the cache. */
+  char* prefix = compile_prefix(impl);
+  char* c_path = cache_path(impl, ".c");
+  char* so_path = cache_path(impl, g_so_suffix);
+  size_t n = strlen(impl->arguments) + strlen(prefix) + (strlen(c_path) + strlen(so_path)) * 4 + 64;
+  char* cmd = (char*)malloc(n);
+  int len = sprintf(cmd, "./generate%s -o %s.tmp && mv -f %s.tmp %s", impl->arguments, c_path, c_path, c_path);
+  if (!g_samples_mode) {
+    sprintf(cmd + len, " && %s -o %s.tmp %s && mv -f %s.tmp %s", prefix, so_path, c_path, so_path, so_path);
+  }
+  free(prefix);
+  free(c_path);
+  free(so_path);
+  return cmd;
+}
+
+static int run_shell(const char* cmd) {
+  int status;
+  pid_t pid = fork();
+  if (pid < 0) FATAL("could not fork");
+  if (pid == 0) {
+    execl("/bin/sh", "sh", "-c", cmd, (char*)NULL);
+    _exit(127);
+  }
+  while (waitpid(pid, &status, 0) < 0) {
+    if (errno != EINTR) FATAL("waitpid failed");
+  }
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
+
+static void ensure_tool(const char* tool, const char* src, const char* const* deps, const char* libs) {
+  /* Build ./generate and ./bench if they are missing, or older than src */
+  /* or any of deps (a NULL-terminated list, or NULL). */
+  struct stat st_tool, st_src;
+  char* cmd;
+  if (stat(src, &st_src) != 0) {
+    if (stat(tool, &st_tool) == 0) return;
+    FATAL("could not find %s or %s", tool, src);
+  }
+  if (stat(tool, &st_tool) == 0 && st_tool.st_mtime >= st_src.st_mtime) {
+    while (deps && *deps && (stat(*deps, &st_src) != 0 || st_tool.st_mtime >= st_src.st_mtime)) ++deps;
+    if (!deps || !*deps) return;
+  }
+  cmd = (char*)malloc(strlen(g_cc) + strlen(g_ccopt) + strlen(tool) + strlen(src) + strlen(libs) + 16);
+  sprintf(cmd, "%s %s -o %s %s%s", g_cc, g_ccopt, tool, src, libs);
+  fprintf(stderr, "%s\n", cmd);
+  if (run_shell(cmd) != 0) FATAL("failed to build %s", tool);
+  free(cmd);
+}
+
+#if defined(__linux__)
+static cpu_set_t g_worker_cpus;
 #endif
-  FILE* f = fopen(g_makefile_path, "wt");
-  ptr_array_t cc_opt = {0};
-  if (g_samples_mode) {
-    fprintf(f, "run:");
+
+static int g_bench_cpus[1024];
+
+#if defined(__linux__)
+static void read_cpu_siblings(int cpu, cpu_set_t* siblings) {
+  /* Hardware threads sharing a physical core with cpu (including itself). */
+  char path[128], list[256];
+  const char* itr = list;
+  FILE* f;
+  CPU_ZERO(siblings);
+  CPU_SET(cpu, siblings);
+  sprintf(path, "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+  if (!(f = fopen(path, "r"))) return;
+  if (fgets(list, sizeof(list), f)) {
+    while ('0' <= *itr && *itr <= '9') {
+      int lo = (int)strtol(itr, (char**)&itr, 10), hi = lo;
+      if (*itr == '-') hi = (int)strtol(itr + 1, (char**)&itr, 10);
+      for (; lo <= hi && lo < CPU_SETSIZE; ++lo) CPU_SET(lo, siblings);
+      if (*itr == ',') ++itr;
+    }
+  }
+  fclose(f);
+}
+#endif
+
+static int choose_cpus(void) {
+  /* Fills g_bench_cpus (-1 for unpinned), sets up g_worker_cpus, and */
+  /* returns the number of ./bench workers. Each ./bench gets a physical */
+  /* core to itself: its SMT siblings are idle, rather than compiling. */
+  int count = 0;
+#if defined(__linux__)
+  cpu_set_t siblings, remaining;
+  int cpu;
+  if (sched_getaffinity(0, sizeof(g_worker_cpus), &g_worker_cpus) == 0) {
+    for (cpu = CPU_SETSIZE - 1; cpu >= 0 && count < g_bench_jobs; --cpu) {
+      if (!CPU_ISSET(cpu, &g_worker_cpus)) continue;
+      read_cpu_siblings(cpu, &siblings);
+      CPU_AND(&siblings, &siblings, &g_worker_cpus);
+      CPU_XOR(&remaining, &g_worker_cpus, &siblings);
+      if (!CPU_COUNT(&remaining)) {
+        /* Leave something for compiling; a lone CPU is shared, as before. */
+        if (!count) g_bench_cpus[count++] = cpu;
+        break;
+      }
+      g_bench_cpus[count++] = cpu;
+      g_worker_cpus = remaining;
+    }
+    if (!g_jobs) g_jobs = CPU_COUNT(&g_worker_cpus);
+  }
+#endif
+  if (!count) g_bench_cpus[count++] = -1;
+  if (!g_jobs) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    g_jobs = n > 1 ? (int)n - 1 : 1;
+  }
+  return count;
+}
+
+/* Workload-weighted ranking, and crossover analysis. */
+/* Each candidate is benchmarked at every size in g_sizes. For --objective, */
+/* it is scored by the time it would spend on the whole weighted mix, being */
+/* sum(weight * size / rate). For --crossover, see print_crossover_report. */
+
+#define MAX_SIZES 256
+
+static uint32_t g_size_count = 0;
+static uint64_t g_sizes[MAX_SIZES];
+static double g_size_weights[MAX_SIZES];
+
+static uint64_t parse_size(const char* value, const char** end) {
+  uint64_t result = 0;
+  const char* itr = value;
+  if (*itr < '0' || *itr > '9') FATAL("invalid size %s", value);
+  while ('0' <= *itr && *itr <= '9') {
+    result = result * 10 + (*itr++ - '0');
+  }
+  if (*itr == 'k' || *itr == 'K') result <<= 10, ++itr;
+  else if (*itr == 'm' || *itr == 'M') result <<= 20, ++itr;
+  else if (*itr == 'g' || *itr == 'G') result <<= 30, ++itr;
+  if (*itr == 'i') ++itr;
+  if (*itr == 'b' || *itr == 'B') ++itr;
+  *end = itr;
+  return result;
+}
+
+static uint32_t add_size(uint64_t size, double weight) {
+  uint32_t i;
+  if (!size) FATAL("sizes must be at least 1 byte");
+  for (i = 0; i < g_size_count; ++i) {
+    if (g_sizes[i] == size) break;
+  }
+  if (i == g_size_count) {
+    if (g_size_count == MAX_SIZES) FATAL("too many distinct sizes in objective");
+    g_sizes[g_size_count] = size;
+    g_size_weights[g_size_count++] = 0.;
+  }
+  g_size_weights[i] += weight;
+  return i;
+}
+
+static void load_objective_trace(const char* path) {
+  /* Lengths are grouped into buckets of [2^k, 2^(k+1)), each represented */
+  /* by its mean length, so that an arbitrary trace becomes a short mix. */
+  double counts[65] = {0.}, bytes[65] = {0.};
+  char line[256];
+  uint32_t k;
+  FILE* f = fopen(path, "r");
+  if (!f) FATAL("could not open trace %s", path);
+  while (fgets(line, sizeof(line), f)) {
+    const char* itr = line;
+    uint64_t len;
+    double count = 1.;
+    while (*itr == ' ' || *itr == '\t') ++itr;
+    if (*itr == '\n' || *itr == '#' || !*itr) continue;
+    len = parse_size(itr, &itr);
+    if (!len) continue; /* Costs nothing, whatever the kernel. */
+    if (*itr == ' ' || *itr == '\t' || *itr == ',') count = strtod(itr + 1, NULL);
+    for (k = 0; len >> k > 1; ++k) {}
+    counts[k + 1] += count;
+    bytes[k + 1] += count * (double)len;
+  }
+  fclose(f);
+  for (k = 0; k < 65; ++k) {
+    if (counts[k] > 0.) add_size((uint64_t)(bytes[k] / counts[k] + 0.5), counts[k]);
+  }
+}
+
+static void parse_size_list(const char* value) {
+  const char* itr = value;
+  for (;;) {
+    add_size(parse_size(itr, &itr), 1.);
+    if (*itr == ',') ++itr;
+    else if (*itr) FATAL("invalid size list %s", value);
+    else break;
+  }
+}
+
+static void setup_sizes(void) {
+  /* Parse g_objective (or -s), and ask ./bench to report a rate per size. */
+  const char* user_sizes = NULL;
+  char* arg;
+  uint32_t i;
+  size_t n;
+  for (i = 0; i < g_bench_args.size; ) {
+    /* Taken out of the bench arguments: bench gets the deduplicated list. */
+    const char* a = (const char*)g_bench_args.contents[i];
+    uint32_t used = 1;
+    if (!strncmp(a, "-s", 2) || !strncmp(a, "--size", 6)) {
+      if (g_objective) FATAL("--objective cannot be combined with %s", a);
+      if (strchr(a, '=')) {
+        user_sizes = strchr(a, '=') + 1;
+      } else if (i + 1 < g_bench_args.size) {
+        user_sizes = (const char*)g_bench_args.contents[i + 1];
+        used = 2;
+      }
+      g_bench_args.size -= used;
+      memmove(g_bench_args.contents + i, g_bench_args.contents + i + used, (g_bench_args.size - i) * sizeof(void*));
+    } else {
+      ++i;
+    }
+  }
+  if (g_chains) {
+    if (user_sizes || g_objective) FATAL("--chains chooses its own sizes");
     for (i = 0; i < g_impls.size; ++i) {
-      impl_t* impl = (impl_t*)g_impls.contents[i];
-      fprintf(f, " %s.c", impl->name);
+      chain_group_t* group = ((impl_t*)g_impls.contents[i])->chain;
+      uint32_t j;
+      if (!group || group->sizes[1]) continue;
+      for (j = 0; j < 8; ++j) {
+        group->sizes[j] = add_size(2 * group->modulus + (2 * j + 1) * group->modulus / 16, 1.);
+      }
     }
+  } else if (!g_objective && !g_crossover && !g_pareto && !g_suite) {
+    parse_size_list(user_sizes ? user_sizes : "512k"); /* ./bench's default. */
+  } else if (user_sizes) {
+    parse_size_list(user_sizes);
+  } else if (!g_objective && !g_crossover) {
+    parse_size_list(g_suite ? "4k,64k,512k,32m" : "64,512k");
+  } else if (!g_objective) {
+    for (i = 4; i <= 20; ++i) add_size(1ull << i, 1.);
+  } else if (*g_objective == '@') {
+    load_objective_trace(g_objective + 1);
   } else {
-    fprintf(f, "run: bench");
-    for (i = 0; i < g_impls.size; ++i) {
-      impl_t* impl = (impl_t*)g_impls.contents[i];
-      fprintf(f, " %s%s", impl->name, so_suffix);
-    }
-    for (j = 0; j < g_impls.size; j += 100) {
-      uint32_t limit = j + 100;
-      if (limit > g_impls.size) limit = g_impls.size;
-      fprintf(f, "\n\t./bench");
-      for (i = 0; i < g_bench_args.size; ++i) {
-        char* arg = (char*)g_bench_args.contents[i];
-        fprintf(f, " %s", arg);
+    const char* itr = g_objective;
+    for (;;) {
+      uint64_t size = parse_size(itr, &itr);
+      double weight = 1.;
+      if (*itr == ':') weight = strtod(itr + 1, (char**)&itr);
+      add_size(size, weight);
+      if (*itr == ',') ++itr;
+      else if (*itr) FATAL("invalid objective %s", g_objective);
+      else break;
+    }
+  }
+  if (!g_size_count) FATAL("empty objective %s", g_objective ? g_objective : "");
+  arg = (char*)malloc(g_size_count * 24 + 8);
+  n = sprintf(arg, "--size=");
+  for (i = 0; i < g_size_count; ++i) {
+    n += sprintf(arg + n, "%s%llu", i ? "," : "", (unsigned long long)g_sizes[i]);
+  }
+  ptr_array_append(&g_bench_args, (void*)arg);
+}
+
+static double* parse_rates(const impl_t* impl, const char* line) {
+  /* Parse the per-size rates (GB/s, i.e. bytes/ns) that bench printed. */
+  const char* itr = line + strlen(impl->name) + strlen(g_so_suffix) + strlen(g_sep);
+  double* rates;
+  uint32_t i;
+  if (!g_size_count || strncmp(line, impl->name, strlen(impl->name))) return NULL;
+  rates = (double*)malloc(g_size_count * sizeof(double));
+  for (i = 0; i < g_size_count; ++i) {
+    char* end;
+    rates[i] = strtod(itr, &end);
+    if (end == itr || rates[i] < 0.) {
+      free(rates);
+      return NULL;
+    }
+    /* bench prints two decimals, so 0.00 is a rate too slow to measure, */
+    /* rather than a failure; it ranks below anything measurable. */
+    if (rates[i] == 0.) rates[i] = 1e-3;
+    itr = end;
+    while (*itr == ',' || *itr == ' ') ++itr;
+  }
+  return rates;
+}
+
+static void score_impl(impl_t* impl, const char* line) {
+  double total_ns = 0., total_weight = 0.;
+  uint32_t i;
+  if (!(impl->rates = parse_rates(impl, line))) return;
+  for (i = 0; i < g_size_count; ++i) {
+    total_ns += g_size_weights[i] * (double)g_sizes[i] / impl->rates[i];
+    total_weight += g_size_weights[i];
+  }
+  if (g_objective) impl->score = total_ns / total_weight;
+}
+
+static int cmp_impl_score(const void* lhs0, const void* rhs0) {
+  impl_t* lhs = *(impl_t**)lhs0;
+  impl_t* rhs = *(impl_t**)rhs0;
+  if (lhs->score != rhs->score) return lhs->score < rhs->score ? -1 : 1;
+  return lhs->original_order - rhs->original_order;
+}
+
+static void print_objective_ranking(void) {
+  ptr_array_t ranked = {0};
+  size_t i;
+  if (!g_objective) return;
+  for (i = 0; i < g_impls.size; ++i) {
+    impl_t* impl = (impl_t*)g_impls.contents[i];
+    if (impl->score >= 0.) ptr_array_append(&ranked, (void*)impl);
+  }
+  if (!ranked.size) return;
+  qsort(ranked.contents, ranked.size, sizeof(void*), cmp_impl_score);
+  if (*g_sep != ',') printf("\nRanked by mean time per call over %s:\n", g_objective);
+  for (i = 0; i < ranked.size; ++i) {
+    impl_t* impl = (impl_t*)ranked.contents[i];
+    printf("%s%s%s%.2f%s\n", impl->name, g_so_suffix, g_sep, impl->score, *g_sep == ',' ? "" : " ns");
+  }
+  free(ranked.contents);
+}
+
+typedef struct fit_t {
+  double a, c; /* ns per call = a + c * len */
+  double a_err, c_err; /* Two standard errors of each. */
+} fit_t;
+
+static uint32_t g_size_order[MAX_SIZES]; /* Indices into g_sizes, by size. */
+
+static void fit_impl(fit_t* fit, const impl_t* impl, uint32_t lo, uint32_t hi) {
+  /* Weighted least squares over g_size_order[lo..hi], with weights 1/t^2 */
+  /* so every size counts equally in relative terms. */
+  double s = 0., sx = 0., sxx = 0., st = 0., sxt = 0., rss = 0., det;
+  uint32_t i;
+  for (i = lo; i <= hi; ++i) {
+    uint32_t k = g_size_order[i];
+    double x = (double)g_sizes[k], t = x / impl->rates[k], w = 1. / (t * t);
+    s += w, sx += w * x, sxx += w * x * x, st += w * t, sxt += w * x * t;
+  }
+  det = s * sxx - sx * sx;
+  fit->a = (sxx * st - sx * sxt) / det;
+  fit->c = (s * sxt - sx * st) / det;
+  for (i = lo; i <= hi; ++i) {
+    uint32_t k = g_size_order[i];
+    double x = (double)g_sizes[k], t = x / impl->rates[k], r = t - fit->a - fit->c * x;
+    rss += r * r / (t * t);
+  }
+  rss = hi - lo > 1 ? rss / (hi - lo - 1) : 0.;
+  fit->a_err = 2. * sqrt(rss * sxx / det);
+  fit->c_err = 2. * sqrt(rss * s / det);
+}
+
+static double crossover(const fit_t* lhs, const fit_t* rhs, double da0, double dc0, double da1, double dc1) {
+  /* Length at which rhs (lower slope) starts to beat lhs, or 1e300 if never. */
+  double dc = (lhs->c + dc0) - (rhs->c + dc1);
+  if (dc <= 0.) return 1e300;
+  return ((rhs->a + da1) - (lhs->a + da0)) / dc;
+}
+
+static double clamp(double x, double lo, double hi) {
+  return x < lo ? lo : x > hi ? hi : x;
+}
+
+static int cmp_size_order(const void* lhs, const void* rhs) {
+  uint64_t l = g_sizes[*(const uint32_t*)lhs], r = g_sizes[*(const uint32_t*)rhs];
+  return l < r ? -1 : l > r;
+}
+
+static const char* find_algo(const char* arguments, size_t* prefix_len) {
+  const char* a = strstr(arguments, " -a ");
+  if (!a) return NULL;
+  *prefix_len = (size_t)(a - arguments);
+  return a + 4;
+}
+
+static void print_crossover_report(void) {
+  /* The fastest candidate is taken at each measured size. Where it differs */
+  /* between adjacent sizes, both candidates are fitted to a + len / rate over */
+  /* the neighbouring sizes, and the crossover is where the fits meet. Bounds */
+  /* come from the fits' standard errors, clamped to the bracketing sizes. */
+  ptr_array_t cands = {0};
+  impl_t* winners[MAX_SIZES];
+  uint32_t thresholds[MAX_SIZES]; /* Between winners[i] and winners[i + 1]. */
+  double bounds[MAX_SIZES][2];
+  uint32_t i, j, m = g_size_count, n_winners = 0;
+  size_t prefix_len = 0, len;
+  const char* prefix = NULL;
+  if (!g_crossover) return;
+  for (i = 0; i < g_impls.size; ++i) {
+    impl_t* impl = (impl_t*)g_impls.contents[i];
+    if (impl->rates) ptr_array_append(&cands, (void*)impl);
+  }
+  if (!cands.size || m < 2) {
+    fprintf(stderr, "--crossover needs results at two or more sizes\n");
+    free(cands.contents);
+    return;
+  }
+  for (i = 0; i < m; ++i) g_size_order[i] = i;
+  qsort(g_size_order, m, sizeof(uint32_t), cmp_size_order);
+  printf("\nCrossover analysis, fitting time per call = a + len / rate:\n");
+  for (i = 0; i < cands.size; ++i) {
+    impl_t* impl = (impl_t*)cands.contents[i];
+    fit_t fit;
+    fit_impl(&fit, impl, 0, m - 1);
+    printf("%s%s%sa = %.1f +/- %.1f ns, rate = %.2f GB/s\n", impl->name, g_so_suffix, g_sep, fit.a, fit.a_err, 1. / fit.c);
+  }
+  printf("Fastest by length:\n");
+  for (i = 0; i < m; ++i) {
+    uint32_t k = g_size_order[i];
+    impl_t* best = NULL;
+    for (j = 0; j < cands.size; ++j) {
+      impl_t* impl = (impl_t*)cands.contents[j];
+      if (!best || impl->rates[k] > best->rates[k]) best = impl;
+    }
+    if (n_winners && best == winners[n_winners - 1]) continue;
+    if (n_winners) {
+      /* Crossover between g_sizes[order[i-1]] and g_sizes[order[i]]. */
+      impl_t* prev = winners[n_winners - 1];
+      double lo_x = (double)g_sizes[g_size_order[i - 1]], hi_x = (double)g_sizes[k];
+      double x, lo = hi_x, hi = lo_x;
+      uint32_t w_lo = i >= 2 ? i - 2 : 0, w_hi = i + 1 < m ? i + 1 : m - 1;
+      fit_t f0, f1;
+      fit_impl(&f0, prev, w_lo, w_hi);
+      fit_impl(&f1, best, w_lo, w_hi);
+      x = clamp(crossover(&f0, &f1, 0., 0., 0., 0.), lo_x, hi_x);
+      for (j = 0; j < 16; ++j) {
+        /* The most extreme crossovers over every corner of the error box. */
+        double cx = clamp(crossover(&f0, &f1,
+          j & 1 ? f0.a_err : -f0.a_err, j & 2 ? f0.c_err : -f0.c_err,
+          j & 4 ? f1.a_err : -f1.a_err, j & 8 ? f1.c_err : -f1.c_err), lo_x, hi_x);
+        if (cx < lo) lo = cx;
+        if (cx > hi) hi = cx;
+      }
+      if (n_winners > 1 && (uint32_t)ceil(x) <= thresholds[n_winners - 2]) {
+        /* Both of prev's crossovers clamped to the same size, so it wins no */
+        /* lengths: drop it, keeping the earlier crossover (and if best won */
+        /* before prev, that one too, as best simply carries on). */
+        if (best == winners[--n_winners - 1]) continue;
+      } else {
+        thresholds[n_winners - 1] = (uint32_t)ceil(x);
+        bounds[n_winners - 1][0] = lo;
+        bounds[n_winners - 1][1] = hi;
+      }
+    }
+    winners[n_winners++] = best;
+  }
+  for (i = 0; i + 1 < n_winners; ++i) {
+    printf("  %u <= len < %u%s%s%s\n", i ? thresholds[i - 1] : 0u, thresholds[i], g_sep, winners[i]->name, g_so_suffix);
+    printf("  crossover at %u (bounds %.0f to %.0f)\n", thresholds[i], bounds[i][0], bounds[i][1]);
+  }
+  printf("  %u <= len%s%s%s\n", n_winners > 1 ? thresholds[n_winners - 2] : 0u,
+    g_sep, winners[n_winners - 1]->name, g_so_suffix);
+  for (i = 0; i < n_winners; ++i) {
+    const char* algo = find_algo(winners[i]->arguments, &len);
+    const char* why = NULL;
+    if (!algo) why = "has no -a";
+    else if (strchr(algo, '/')) why = "is already dispatched";
+    else if (prefix && (len != prefix_len || memcmp(prefix, winners[i]->arguments, len))) why = "differs in ISA or polynomial";
+    if (why) {
+      printf("No dispatch spec, as winner %s%s %s.\n", winners[i]->name, g_so_suffix, why);
+      free(cands.contents);
+      return;
+    }
+    prefix = winners[i]->arguments, prefix_len = len;
+  }
+  printf("Dispatch: ./generate%.*s -a ", (int)prefix_len, prefix);
+  for (i = 0; i < n_winners; ++i) {
+    if (i) printf("/%u/", thresholds[i - 1]);
+    printf("%s", find_algo(winners[i]->arguments, &len));
+  }
+  printf("\n");
+  free(cands.contents);
+}
+
+/* Pareto frontier over throughput, code size, and small-size latency. */
+
+static uint64_t read_le(const unsigned char* p, uint32_t n) {
+  uint64_t result = 0;
+  while (n--) result = (result << 8) | p[n];
+  return result;
+}
+
+static uint64_t text_size(const char* path) {
+  /* Size of .text (ELF64) or __TEXT,__text (Mach-O 64), or 0 if unknown. */
+  uint64_t result = 0;
+  unsigned char* data;
+  long n;
+  FILE* f = fopen(path, "rb");
+  if (!f) return 0;
+  fseek(f, 0, SEEK_END);
+  n = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  data = (unsigned char*)malloc(n > 64 ? n : 64);
+  if (fread(data, 1, n, f) != (size_t)n) n = 0;
+  fclose(f);
+  if (n >= 64 && !memcmp(data, "\x7f" "ELF\x02\x01", 6)) {
+    uint64_t shoff = read_le(data + 0x28, 8);
+    uint32_t shentsize = read_le(data + 0x3a, 2), shnum = read_le(data + 0x3c, 2), i;
+    uint64_t strtab = shoff + (uint64_t)shentsize * read_le(data + 0x3e, 2);
+    if (shentsize >= 64 && shoff + (uint64_t)shentsize * shnum <= (uint64_t)n && strtab + 64 <= (uint64_t)n) {
+      uint64_t names = read_le(data + strtab + 24, 8);
+      for (i = 0; i < shnum; ++i) {
+        const unsigned char* sh = data + shoff + (uint64_t)shentsize * i;
+        uint64_t name = names + read_le(sh, 4);
+        if (name + 6 <= (uint64_t)n && !memcmp(data + name, ".text", 6)) result = read_le(sh + 32, 8);
       }
-      fprintf(f, " --");
-      for (i = j; i < limit; ++i) {
-        impl_t* impl = (impl_t*)g_impls.contents[i];
-        fprintf(f, " ./%s%s", impl->name, so_suffix);
+    }
+  } else if (n >= 32 && read_le(data, 4) == 0xfeedfacfu) {
+    uint64_t off = 32, end = 32 + read_le(data + 20, 4);
+    uint32_t ncmds = read_le(data + 16, 4), i, j;
+    for (i = 0; i < ncmds && off + 72 <= end && end <= (uint64_t)n; ++i) {
+      uint32_t cmd = read_le(data + off, 4), cmdsize = read_le(data + off + 4, 4);
+      if (cmd == 0x19) { /* LC_SEGMENT_64 */
+        uint32_t nsects = read_le(data + off + 64, 4);
+        for (j = 0; j < nsects && off + 72 + 80 * (j + 1) <= end; ++j) {
+          const unsigned char* sect = data + off + 72 + 80 * j;
+          if (!strncmp((const char*)sect, "__text", 16)) result = read_le(sect + 40, 8);
+        }
       }
+      if (!cmdsize) break;
+      off += cmdsize;
+    }
+  }
+  free(data);
+  return result;
+}
+
+typedef struct pareto_t {
+  impl_t* impl;
+  double rate; /* GB/s at the largest size. */
+  double latency; /* ns per call at the smallest size. */
+  uint64_t code; /* Bytes of .text. */
+} pareto_t;
+
+static int pareto_dominates(const pareto_t* lhs, const pareto_t* rhs) {
+  if (lhs->rate < rhs->rate || lhs->latency > rhs->latency || lhs->code > rhs->code) return 0;
+  return lhs->rate > rhs->rate || lhs->latency < rhs->latency || lhs->code < rhs->code;
+}
+
+static int cmp_pareto_code(const void* lhs0, const void* rhs0) {
+  const pareto_t* lhs = (const pareto_t*)lhs0;
+  const pareto_t* rhs = (const pareto_t*)rhs0;
+  if (lhs->code != rhs->code) return lhs->code < rhs->code ? -1 : 1;
+  return lhs->impl->original_order - rhs->impl->original_order;
+}
+
+static void print_pareto_report(void) {
+  pareto_t* cands = (pareto_t*)calloc(g_impls.size + 1, sizeof(pareto_t));
+  uint32_t lo = 0, hi = 0, i;
+  size_t n = 0, j, k;
+  double peak = 0.;
+  char* path;
+  if (!g_pareto) return;
+  for (i = 1; i < g_size_count; ++i) {
+    if (g_sizes[i] < g_sizes[lo]) lo = i;
+    if (g_sizes[i] > g_sizes[hi]) hi = i;
+  }
+  for (j = 0; j < g_impls.size; ++j) {
+    impl_t* impl = (impl_t*)g_impls.contents[j];
+    if (!impl->rates) continue;
+    /* From the cache: results replayed from the journal are never */
+    /* published to NAME.so, which may then be missing or stale. */
+    if (impl->prebuilt) {
+      path = (char*)malloc(strlen(impl->name) + strlen(g_so_suffix) + 1);
+      sprintf(path, "%s%s", impl->name, g_so_suffix);
+    } else {
+      path = cache_path(impl, g_so_suffix);
+    }
+    cands[n].impl = impl;
+    cands[n].rate = impl->rates[hi];
+    cands[n].latency = (double)g_sizes[lo] / impl->rates[lo];
+    cands[n].code = text_size(path);
+    if (cands[n].rate > peak) peak = cands[n].rate;
+    free(path);
+    ++n;
+  }
+  qsort(cands, n, sizeof(pareto_t), cmp_pareto_code);
+  printf("\nPareto frontier over throughput at %llu bytes, .text size, and latency at %llu bytes:\n",
+    (unsigned long long)g_sizes[hi], (unsigned long long)g_sizes[lo]);
+  for (j = 0; j < n; ++j) {
+    for (k = 0; k < n && !pareto_dominates(&cands[k], &cands[j]); ++k) {}
+    if (k < n) continue;
+    printf("%s%s%s%.2f GB/s (%.0f%% of peak), %llu bytes, %.1f ns\n", cands[j].impl->name, g_so_suffix, g_sep,
+      cands[j].rate, 100. * cands[j].rate / peak, (unsigned long long)cands[j].code, cands[j].latency);
+  }
+  free(cands);
+}
+
+/* Fallback chain report. */
+
+static double chain_score(const impl_t* impl) {
+  /* Mean ns per call over the residual lengths of the chain's group. */
+  double total = 0.;
+  uint32_t j;
+  for (j = 0; j < 8; ++j) {
+    uint32_t k = impl->chain->sizes[j];
+    total += (double)g_sizes[k] / impl->rates[k];
+  }
+  return total / 8;
+}
+
+static int str_eq(const char* a, const char* b) {
+  return a == b || (a && b && !strcmp(a, b));
+}
+
+static void print_chain_report(void) {
+  size_t i, j;
+  if (!g_chains) return;
+  printf("\nBest fallback chain per first phase, by mean time per call over residual lengths:\n");
+  for (i = 0; i < g_impls.size; ++i) {
+    impl_t* impl = (impl_t*)g_impls.contents[i];
+    impl_t* best = NULL;
+    impl_t* plain = NULL;
+    if (!impl->chain || !impl->rates) continue;
+    for (j = 0; j < g_impls.size; ++j) {
+      impl_t* other = (impl_t*)g_impls.contents[j];
+      if (other->chain != impl->chain || !str_eq(other->cc, impl->cc) || !str_eq(other->ccopt, impl->ccopt) || !other->rates) continue;
+      if (j < i) break; /* Group already reported. */
+      if (!best || chain_score(other) < chain_score(best)) best = other;
+      if (!strcmp(strstr(other->arguments, " -a ") + 4, strstr(impl->chain->main, " -a ") + 4)) plain = other;
     }
+    if (j < g_impls.size) continue;
+    printf("%s%s%s%.1f ns", best->name, g_so_suffix, g_sep, chain_score(best));
+    if (plain && plain != best) printf(" (%.1f ns without follow-on phases)", chain_score(plain));
+    printf(", residues of %u bytes\n", impl->chain->modulus);
+  }
+}
+
+/* Code placement report, for --align. */
+
+typedef struct placement_t {
+  impl_t* base;
+  double worst, best; /* GB/s at the largest size. */
+  uint32_t best_padding;
+} placement_t;
+
+static int cmp_placement_worst(const void* lhs0, const void* rhs0) {
+  const placement_t* lhs = (const placement_t*)lhs0;
+  const placement_t* rhs = (const placement_t*)rhs0;
+  if (lhs->worst != rhs->worst) return lhs->worst > rhs->worst ? -1 : 1;
+  return lhs->base->original_order - rhs->base->original_order;
+}
+
+static void print_align_report(void) {
+  placement_t* rows;
+  uint32_t hi = 0, k;
+  size_t n = 0, i, j;
+  if (!g_align_list) return;
+  rows = (placement_t*)calloc(g_impls.size + 1, sizeof(placement_t));
+  for (k = 1; k < g_size_count; ++k) {
+    if (g_sizes[k] > g_sizes[hi]) hi = k;
   }
-  fprintf(f, "\n\n");
-  ptr_array_append(&cc_opt, (void*)cc_shared);
   for (i = 0; i < g_impls.size; ++i) {
     impl_t* impl = (impl_t*)g_impls.contents[i];
-    fprintf(f, "%s.c: generate\n", impl->name);
-    fprintf(f, "\t./generate%s -o $@\n\n", impl->arguments);
-    if (g_samples_mode) {
-      continue;
+    double rate;
+    if (!impl->placement_of || !impl->rates) continue;
+    rate = impl->rates[hi];
+    for (j = 0; j < n && rows[j].base != impl->placement_of; ++j) {}
+    if (j == n) {
+      rows[n].base = impl->placement_of;
+      rows[n].worst = rows[n].best = rate;
+      rows[n++].best_padding = impl->padding;
+    } else if (rate < rows[j].worst) {
+      rows[j].worst = rate;
+    } else if (rate > rows[j].best) {
+      rows[j].best = rate;
+      rows[j].best_padding = impl->padding;
     }
-    fprintf(f, "%s%s: %s.c\n", impl->name, so_suffix, impl->name);
-    cc_opt.size = 1;
-    if (strstr(impl->arguments, "-i avx") || strstr(impl->arguments, "-i sse")) {
-      ptr_array_append(&cc_opt, (void*)"-msse4.2 -mpclmul");
-      if (strstr(impl->arguments, "-i avx512")) {
-        ptr_array_append(&cc_opt, (void*)"-mavx512f -mavx512vl");
-        if (strstr(impl->arguments, "-i avx512_vpclmulqdq")) {
-          ptr_array_append(&cc_opt, (void*)"-mvpclmulqdq");
-        }
+  }
+  qsort(rows, n, sizeof(placement_t), cmp_placement_worst);
+  printf("\nCode placement at %llu bytes, by worst case over %s nops of padding:\n",
+    (unsigned long long)g_sizes[hi], g_align_list);
+  for (j = 0; j < n; ++j) {
+    printf("%s%s%s%.2f to %.2f GB/s (%.1f%% spread), best with %u nops\n", rows[j].base->name, g_so_suffix, g_sep,
+      rows[j].worst, rows[j].best, 100. * (rows[j].best - rows[j].worst) / rows[j].best, rows[j].best_padding);
+  }
+  if (n) {
+    printf("To pin the placement of %s, add to its CCOPT:" ALIGN_FLAGS "%u\n", rows[0].base->name, rows[0].best_padding);
+  }
+  free(rows);
+}
+
+/* Standard suite, against third-party baselines. */
+
+typedef struct suite_row_t {
+  const char* label; /* As in the README tables. */
+  const char* baseline; /* Target in third_party/Makefile, sans suffix, or NULL. */
+  const char* isa;
+  const char* poly;
+  const char* algo;
+  const char* cpu_flags; /* Space-separated; a leading - means must be absent. */
+  impl_t* ours;
+  impl_t* theirs;
+} suite_row_t;
+
+static suite_row_t g_suite_rows[] = {
+  {"Chromium vector", "chromium_sse_crc32_v4_v1", "sse", "crc32", "v4_v1", "sse4_2 pclmulqdq", NULL, NULL},
+  {"Chromium vector AVX512", "chromium_avx512_vpclmulqdq_crc32_v4_v1", "avx512_vpclmulqdq", "crc32", "v4_v1", "avx512f avx512vl vpclmulqdq", NULL, NULL},
+  {"crc32_4k_three_way", "corsix4k_sse_crc32c_s3k4096e", "sse", "crc32c", "s3k4096e", "sse4_2 pclmulqdq", NULL, NULL},
+  {"retuned crc32_4k_three_way", NULL, "sse", "crc32c", "s3", "sse4_2 pclmulqdq", NULL, NULL},
+  {"crc32_4k_pclmulqdq", "corsix4k_sse_crc32c_v4k4096e", "sse", "crc32c", "v4k4096e", "sse4_2 pclmulqdq", NULL, NULL},
+  {"retuned crc32_4k_pclmulqdq", NULL, "sse", "crc32c", "v4e", "sse4_2 pclmulqdq", NULL, NULL},
+  {"AVX512 crc32_4k_pclmulqdq", NULL, "avx512", "crc32c", "v4e", "avx512f avx512vl -vpclmulqdq", NULL, NULL},
+  {"AVX512 crc32_4k_pclmulqdq", NULL, "avx512_vpclmulqdq", "crc32c", "v4e", "avx512f avx512vl vpclmulqdq", NULL, NULL},
+  {"crc32_4k_fusion", "corsix4k_sse_crc32c_v4s3x3k4096e", "sse", "crc32c", "v4s3x3k4096e", "sse4_2 pclmulqdq", NULL, NULL},
+  {"retuned crc32_4k_fusion", NULL, "sse", "crc32c", "v8s3x3", "sse4_2 pclmulqdq", NULL, NULL},
+  {"AVX512 crc32_4k_fusion", NULL, "avx512", "crc32c", "v9s3x4e", "avx512f avx512vl -vpclmulqdq", NULL, NULL},
+  {"AVX512 crc32_4k_fusion", NULL, "avx512_vpclmulqdq", "crc32c", "v3s1_s3", "avx512f avx512vl vpclmulqdq", NULL, NULL},
+};
+
+static int host_has_cpu_flags(const char* cpuinfo_flags, const char* wanted) {
+  char flag[64];
+  while (*wanted) {
+    size_t n = strcspn(wanted, " ");
+    int negate = *wanted == '-';
+    const char* found;
+    snprintf(flag, sizeof(flag), " %.*s", (int)(n - negate), wanted + negate);
+    found = strstr(cpuinfo_flags, flag);
+    while (found && found[strlen(flag)] && found[strlen(flag)] != ' ' && found[strlen(flag)] != '\n') {
+      found = strstr(found + 1, flag);
+    }
+    if ((found == NULL) != negate) return 0;
+    wanted += n + (wanted[n] == ' ');
+  }
+  return 1;
+}
+
+static void create_suite_impls(void) {
+  char line[8192], flags[8192] = "";
+  char* cmd = (char*)malloc(4096);
+  size_t n = 0, i;
+  FILE* f;
+#if !defined(__linux__) || !(defined(__x86_64__) || defined(_M_X64))
+  FATAL("--suite is only for x86_64 Linux");
+#endif
+  if ((f = fopen("/proc/cpuinfo", "r"))) {
+    while (fgets(line, sizeof(line), f)) {
+      if (!strncmp(line, "flags", 5) && strchr(line, ':')) {
+        snprintf(flags, sizeof(flags), " %s", strchr(line, ':') + 1);
+        break;
       }
     }
-#if !(defined(__MACH__) && defined(__APPLE__))
-    if (strstr(impl->arguments, "-i neon")) {
-      if (strstr(impl->arguments, "-i neon_eor3")) {
-        ptr_array_append(&cc_opt, (void*)"-march=armv8.2-a+crypto+sha3");
+    fclose(f);
+  }
+  for (i = 0; i < g_impls.size; ++i) free(g_impls.contents[i]); /* The suite replaces -i/-p/-a. */
+  g_impls.size = 0;
+  n = sprintf(cmd, "make -C third_party");
+  for (i = 0; i < sizeof(g_suite_rows) / sizeof(g_suite_rows[0]); ++i) {
+    suite_row_t* row = &g_suite_rows[i];
+    if (!host_has_cpu_flags(flags, row->cpu_flags)) continue;
+    create_impl(row->isa, row->poly, row->algo);
+    row->ours = (impl_t*)g_impls.contents[g_impls.size - 1];
+    if (row->baseline) {
+      impl_t* theirs = (impl_t*)calloc(1, sizeof(impl_t) + strlen(row->baseline) + 16);
+      theirs->name = (char*)(theirs + 1);
+      sprintf(theirs->name, "third_party/%s", row->baseline);
+      theirs->arguments = theirs->name + strlen(theirs->name); /* Empty. */
+      theirs->original_order = (int)g_impls.size;
+      theirs->score = -1.;
+      theirs->prebuilt = 1;
+      ptr_array_append(&g_impls, (void*)theirs);
+      row->theirs = theirs;
+      n += sprintf(cmd + n, " %s%s", row->baseline, g_so_suffix);
+    }
+  }
+  fprintf(stderr, "%s\n", cmd);
+  if (run_shell(cmd) != 0) FATAL("failed to build third-party baselines");
+  free(cmd);
+}
+
+static void print_suite_report(void) {
+  uint32_t k;
+  size_t i;
+  if (!g_suite) return;
+  for (k = 0; k < g_size_count; ++k) {
+    printf("\nAt %llu bytes:\n\n", (unsigned long long)g_sizes[k]);
+    printf("| Implementation | Speed | Our equivalent | Speed | Speedup |\n");
+    printf("| -------------- | ----: | -------------- | ----: | ------: |\n");
+    for (i = 0; i < sizeof(g_suite_rows) / sizeof(g_suite_rows[0]); ++i) {
+      suite_row_t* row = &g_suite_rows[i];
+      if (!row->ours) continue;
+      printf("| %s | ", row->label);
+      if (row->theirs && row->theirs->rates) printf("%.2f GB/s", row->theirs->rates[k]);
+      else printf("N/A");
+      printf(" | `-i %s -p %s -a %s` | ", row->isa, row->poly, row->algo);
+      if (row->ours->rates) printf("%.2f GB/s", row->ours->rates[k]);
+      else printf("N/A");
+      if (row->theirs && row->theirs->rates && row->ours->rates) {
+        printf(" | %.2fx |\n", row->ours->rates[k] / row->theirs->rates[k]);
       } else {
-        ptr_array_append(&cc_opt, (void*)"-march=armv8-a+crypto+crc");
+        printf(" | |\n");
+      }
+    }
+  }
+}
+
+/* Persistent tuning database. */
+/* One row per (candidate, size) benchmarked, tab-separated, of the form: */
+/* CPU-FINGERPRINT  CPU-NAME  POLY  SIZE  COMPILER  ARGUMENTS  CFLAGS  GB/S */
+
+static void read_cpuinfo(char* fingerprint, char* cpu_name, size_t n) {
+  /* fingerprint is vendor/family/model/stepping/microcode on x86, and */
+  /* implementer/part/variant/revision on aarch64. */
+  static const char* const fields[] = {
+    "vendor_id", "cpu family", "model", "stepping", "microcode",
+    "CPU implementer", "CPU part", "CPU variant", "CPU revision", NULL
+  };
+  char values[9][64] = {{0}};
+  char line[512];
+  size_t len = 0;
+  uint32_t i, first, last, processors = 0;
+  FILE* f = fopen("/proc/cpuinfo", "r");
+  strcpy(fingerprint, "unknown");
+  strcpy(cpu_name, "unknown");
+  if (!f) {
+#if defined(__MACH__) && defined(__APPLE__)
+    if ((f = popen("sysctl -n machdep.cpu.brand_string", "r"))) {
+      if (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\t\n")] = '\0';
+        snprintf(fingerprint, n, "%s", line);
+        snprintf(cpu_name, n, "%s", line);
       }
+      pclose(f);
+    }
+#endif
+    return;
+  }
+  while (fgets(line, sizeof(line), f)) {
+    char* colon = strchr(line, ':');
+    char* key_end;
+    if (!strncmp(line, "processor", 9) && processors++) break; /* Just the first CPU. */
+    if (!colon) continue;
+    for (key_end = colon; key_end > line && (key_end[-1] == ' ' || key_end[-1] == '\t'); --key_end) {}
+    *key_end = '\0';
+    colon += 1 + (colon[1] == ' ');
+    colon[strcspn(colon, "\t\n")] = '\0';
+    if (!strcmp(line, "model name") || !strcmp(line, "Hardware")) {
+      snprintf(cpu_name, n, "%s", colon);
+      continue;
     }
-#endif    
-    fprintf(f, "\t$(CC) $(CCOPT)");
-    for (j = 0; j < cc_opt.size; ++j) {
-      fprintf(f, " %s", (const char*)cc_opt.contents[j]);
+    for (i = 0; fields[i]; ++i) {
+      if (!strcmp(line, fields[i]) && !values[i][0]) snprintf(values[i], sizeof(values[i]), "%s", colon);
     }
-    fprintf(f, " -o $@ $<\n\n");
   }
-  fprintf(f, "include Makefile\n");
   fclose(f);
+  first = values[0][0] ? 0 : 5;
+  last = values[0][0] ? 5 : 9;
+  if (!values[first][0]) return;
+  for (i = first; i < last && len + 1 < n; ++i) {
+    len += snprintf(fingerprint + len, n - len, "%s%s", len ? "/" : "", values[i][0] ? values[i] : "?");
+  }
 }
 
-static void init_make_args(const char* self_path) {
-  char* dirsep = strrchr(self_path, '/');
-  ptr_array_append(&g_make_args, (void*)"make");
-  if (dirsep && !(dirsep == self_path + 1 && self_path[0] == '.')) {
-    size_t dirlen = (dirsep + 1 - self_path);
-    size_t bothlen = dirlen + strlen(g_makefile_path) + 1;
-    char* joined = (char*)malloc(bothlen * 2);
-    char* separate = joined + bothlen;
-    memcpy(joined, self_path, dirlen);
-    memcpy(joined + dirlen, g_makefile_path, bothlen - dirlen);
-    g_makefile_path = joined;
-    memcpy(separate, joined, bothlen);
-    separate[dirlen - 1] = 0;
-    ptr_array_append(&g_make_args, (void*)"-C");
-    ptr_array_append(&g_make_args, (void*)separate);
-    ptr_array_append(&g_make_args, (void*)"-f");
-    ptr_array_append(&g_make_args, (void*)(separate + dirlen));
+static const char* compiler_version(const char* cc) {
+  /* First line of $CC --version, memoised per compiler. */
+  static string_array_t names, versions;
+  uint32_t i;
+  char line[256] = "unknown", *cmd;
+  FILE* f;
+  for (i = 0; i < names.string_count; ++i) {
+    if (!strcmp(names.data + names.offsets[i], cc)) return versions.data + versions.offsets[i];
+  }
+  cmd = (char*)malloc(strlen(cc) + 32);
+  sprintf(cmd, "%s --version 2>/dev/null", cc);
+  if ((f = popen(cmd, "r"))) {
+    if (!fgets(line, sizeof(line), f)) strcpy(line, "unknown");
+    pclose(f);
+  }
+  free(cmd);
+  line[strcspn(line, "\t\n")] = '\0';
+  string_array_append(&names, cc);
+  string_array_append(&versions, line);
+  return versions.data + versions.offsets[i];
+}
+
+static void db_append(impl_t* impl) {
+  static FILE* f = NULL;
+  static char fingerprint[256], cpu_name[256];
+  const char* poly = strstr(impl->arguments, "-p ");
+  uint32_t i;
+  if (!f) {
+    if (!(f = fopen(g_db_path, "a"))) FATAL("could not open %s", g_db_path);
+    read_cpuinfo(fingerprint, cpu_name, sizeof(fingerprint));
+  }
+  poly = poly ? poly + 3 : "crc32 ";
+  for (i = 0; i < g_size_count; ++i) {
+    fprintf(f, "%s\t%s\t%.*s\t%llu\t%s\t%s\t%s\t%.2f\n", fingerprint, cpu_name, (int)strcspn(poly, " "), poly,
+      (unsigned long long)g_sizes[i], compiler_version(impl->cc ? impl->cc : g_cc), impl->arguments + 1,
+      impl->ccopt ? impl->ccopt : g_ccopt, impl->rates[i]);
+  }
+  fflush(f);
+}
+
+typedef struct db_row_t {
+  char* fields[8];
+  uint64_t size_class;
+  double rate;
+} db_row_t;
+
+static int cmp_db_row(const void* lhs0, const void* rhs0) {
+  /* By (fingerprint, poly, size class, compiler), then best rate first. */
+  const db_row_t* lhs = *(const db_row_t* const*)lhs0;
+  const db_row_t* rhs = *(const db_row_t* const*)rhs0;
+  int cmp = strcmp(lhs->fields[0], rhs->fields[0]);
+  if (!cmp) cmp = strcmp(lhs->fields[2], rhs->fields[2]);
+  if (!cmp && lhs->size_class != rhs->size_class) cmp = lhs->size_class < rhs->size_class ? -1 : 1;
+  if (!cmp) cmp = strcmp(lhs->fields[4], rhs->fields[4]);
+  if (!cmp && lhs->rate != rhs->rate) cmp = lhs->rate > rhs->rate ? -1 : 1;
+  return cmp;
+}
+
+static void put_json_str(const char* str) {
+  putchar('"');
+  for (; *str; ++str) {
+    if (*str == '"' || *str == '\\') putchar('\\');
+    putchar(*str);
+  }
+  putchar('"');
+}
+
+static int run_query(void) {
+  /* Size classes are powers of two: a row for size S counts towards the */
+  /* smallest power of two >= S. */
+  ptr_array_t rows = {0};
+  char line[4096];
+  size_t i, n = 0;
+  int json = !strcmp(g_query, "json");
+  FILE* f;
+  if (!json && strcmp(g_query, "header")) FATAL("unknown query format %s", g_query);
+  if (!(f = fopen(g_db_path, "r"))) FATAL("could not open %s", g_db_path);
+  while (fgets(line, sizeof(line), f)) {
+    db_row_t* row = (db_row_t*)calloc(1, sizeof(db_row_t));
+    char* itr = strdup(line);
+    uint32_t k;
+    itr[strcspn(itr, "\n")] = '\0';
+    for (k = 0; k < 8 && itr; ++k) {
+      row->fields[k] = itr;
+      if ((itr = strchr(itr, '\t'))) *itr++ = '\0';
+    }
+    if (k < 8) {
+      free(row->fields[0]);
+      free(row);
+      continue;
+    }
+    for (row->size_class = 1; row->size_class < strtoull(row->fields[3], NULL, 10); row->size_class <<= 1) {}
+    row->rate = strtod(row->fields[7], NULL);
+    ptr_array_append(&rows, (void*)row);
+  }
+  fclose(f);
+  qsort(rows.contents, rows.size, sizeof(void*), cmp_db_row);
+  if (json) {
+    printf("[");
   } else {
-    ptr_array_append(&g_make_args, (void*)"-f");
-    ptr_array_append(&g_make_args, (void*)g_makefile_path);
+    printf("/* Generated by autobench --query=header from %s */\n", g_db_path);
+    printf("static const struct {\n");
+    printf("  const char* cpu; /* vendor/family/model/stepping/microcode, or implementer/part/variant/revision */\n");
+    printf("  const char* poly;\n");
+    printf("  unsigned long size_class; /* Lengths up to this many bytes. */\n");
+    printf("  const char* compiler;\n");
+    printf("  const char* generate_args;\n");
+    printf("  const char* cflags;\n");
+    printf("  double gbps;\n");
+    printf("} crc32_tuned[] = {\n");
+  }
+  for (i = 0; i < rows.size; ++i) {
+    db_row_t* row = (db_row_t*)rows.contents[i];
+    if (i) {
+      db_row_t* prev = (db_row_t*)rows.contents[i - 1];
+      if (!strcmp(prev->fields[0], row->fields[0]) && !strcmp(prev->fields[2], row->fields[2]) &&
+          prev->size_class == row->size_class && !strcmp(prev->fields[4], row->fields[4])) continue;
+    }
+    if (json) {
+      printf("%s\n  {\"cpu\": ", n++ ? "," : "");
+      put_json_str(row->fields[0]);
+      printf(", \"cpu_name\": "); put_json_str(row->fields[1]);
+      printf(", \"poly\": "); put_json_str(row->fields[2]);
+      printf(", \"size_class\": %llu, \"compiler\": ", (unsigned long long)row->size_class);
+      put_json_str(row->fields[4]);
+      printf(", \"generate_args\": "); put_json_str(row->fields[5]);
+      printf(", \"cflags\": "); put_json_str(row->fields[6]);
+      printf(", \"gbps\": %.2f}", row->rate);
+    } else {
+      if (!n++ || strcmp(((db_row_t*)rows.contents[i - 1])->fields[0], row->fields[0])) printf("  /* %s */\n", row->fields[1]);
+      printf("  {");
+      put_json_str(row->fields[0]);
+      printf(", "); put_json_str(row->fields[2]);
+      printf(", %llu, ", (unsigned long long)row->size_class);
+      put_json_str(row->fields[4]);
+      printf(", "); put_json_str(row->fields[5]);
+      printf(", "); put_json_str(row->fields[6]);
+      printf(", %.2f},\n", row->rate);
+    }
+  }
+  printf(json ? "\n]\n" : "};\n");
+  return EXIT_SUCCESS;
+}
+
+static void set_cloexec(int fd) {
+  fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | FD_CLOEXEC);
+}
+
+static pid_t spawn_worker(const char* cmd) {
+  pid_t pid = fork();
+  if (pid < 0) FATAL("could not fork");
+  if (pid == 0) {
+    signal(SIGPIPE, SIG_DFL);
+#if defined(__linux__)
+    sched_setaffinity(0, sizeof(g_worker_cpus), &g_worker_cpus);
+#endif
+    execl("/bin/sh", "sh", "-c", cmd, (char*)NULL);
+    _exit(127);
+  }
+  return pid;
+}
+
+static pid_t spawn_bench(int bench_cpu, FILE** to_bench, int* from_bench) {
+  ptr_array_t args = {0};
+  char cpu_arg[32];
+  int in_fds[2], out_fds[2];
+  pid_t pid;
+  size_t i;
+  ptr_array_append(&args, (void*)"./bench");
+  for (i = 0; i < g_bench_args.size; ++i) {
+    ptr_array_append(&args, g_bench_args.contents[i]);
+  }
+  if (bench_cpu >= 0) {
+    sprintf(cpu_arg, "--cpu=%d", bench_cpu);
+    ptr_array_append(&args, (void*)cpu_arg);
+  }
+  ptr_array_append(&args, (void*)"--");
+  ptr_array_append(&args, (void*)"-");
+  ptr_array_append(&args, NULL);
+  if (pipe(in_fds) || pipe(out_fds)) FATAL("could not create pipe");
+  set_cloexec(in_fds[1]);
+  set_cloexec(out_fds[0]);
+  pid = fork();
+  if (pid < 0) FATAL("could not fork");
+  if (pid == 0) {
+    signal(SIGPIPE, SIG_DFL);
+    dup2(in_fds[0], 0);
+    dup2(out_fds[1], 1);
+    close(in_fds[0]);
+    close(out_fds[1]);
+    execv("./bench", (char* const*)args.contents);
+    _exit(127);
+  }
+  close(in_fds[0]);
+  close(out_fds[1]);
+  *to_bench = fdopen(in_fds[1], "w");
+  *from_bench = out_fds[0];
+  free(args.contents);
+  return pid;
+}
+
+static int g_sigchld_fds[2];
+
+static void on_sigchld(int sig) {
+  int saved_errno = errno;
+  (void)sig;
+  if (write(g_sigchld_fds[1], "", 1) < 0) {
+    /* Pipe already full, which is fine. */
+  }
+  errno = saved_errno;
+}
+
+static void report(impl_t* impl, const char* line, int record) {
+  printf("%s\n", line);
+  fflush(stdout);
+  if (impl && line[strlen(line) - 1] != '!') {
+    if (record) journal_append(impl, line);
+    score_impl(impl, line);
+    if (record && impl->rates && !impl->prebuilt) db_append(impl);
   }
 }
 
-static void exec_make(void) {
-  ptr_array_append(&g_make_args, (void*)"run");
-  ptr_array_append(&g_make_args, NULL);
-  execvp((const char*)g_make_args.contents[0], (char* const*)g_make_args.contents);
-  FATAL("failed to exec: make %s", g_makefile_path);
+/* With several ./bench workers, each periodically re-measures a fixed */
+/* reference kernel. Results are scaled by (quiet reference rate on the */
+/* first worker) / (latest reference rate on this worker), so that neither */
+/* interference between workers nor differences between cores skew the */
+/* rankings. The quiet rates are measured one worker at a time. */
+
+#define REF_INTERVAL 8
+#define BENCH_QUEUE 4
+
+typedef struct bench_t {
+  pid_t pid; /* Negated once reaped. */
+  FILE* to;
+  int fd; /* Its stdout, or -1 once exhausted. */
+  char* rbuf;
+  size_t rlen;
+  size_t rcap;
+  impl_t* queue[BENCH_QUEUE]; /* Sent but not yet reported. */
+  uint32_t queue_head, queue_tail;
+  uint32_t since_ref;
+  int calibrated;
+  double* quiet; /* Reference rates measured without interference. */
+  double* ref; /* Latest reference rates. */
+} bench_t;
+
+static impl_t* g_ref_impl;
+
+static impl_t* create_ref_impl(void) {
+  /* Portable, so it can run anywhere; memory-light, like any candidate. */
+  create_impl("", "crc32c", "s1");
+  return (impl_t*)g_impls.contents[--g_impls.size];
+}
+
+static void bench_send(bench_t* b, impl_t* impl) {
+  fprintf(b->to, "./%s%s\n", impl->name, g_so_suffix);
+  fflush(b->to);
+  b->queue[b->queue_tail++ % BENCH_QUEUE] = impl;
+}
+
+static void report_normalised(bench_t* b, bench_t* first, impl_t* impl, const char* line) {
+  double* rates = parse_rates(impl, line);
+  char* out;
+  size_t n;
+  uint32_t k;
+  int csv = *g_sep == ',';
+  if (!rates || !first->quiet || !b->ref) {
+    report(impl, line, 1);
+    return;
+  }
+  out = (char*)malloc(strlen(impl->name) + strlen(g_so_suffix) + strlen(g_sep) + g_size_count * 32 + 8);
+  n = sprintf(out, "%s%s", impl->name, g_so_suffix);
+  for (k = 0; k < g_size_count; ++k) {
+    n += sprintf(out + n, "%s%.2f", k ? (csv ? "," : " ") : g_sep, rates[k] * first->quiet[k] / b->ref[k]);
+  }
+  if (!csv) sprintf(out + n, " GB/s");
+  report(impl, out, 1);
+  free(out);
+  free(rates);
+}
+
+static int run_pipeline(void) {
+  size_t next = 0, running = 0, ready_head = 0, ready_tail = 0, i;
+  impl_t** ready = (impl_t**)calloc(g_impls.size + 1, sizeof(impl_t*)); /* Built, awaiting ./bench. */
+  size_t n_bench = (size_t)choose_cpus(), alive = 0, calibrated = 0;
+  int failed = 0, status, parallel = n_bench > 1;
+  pid_t pid;
+  pid_t* worker_pids = (pid_t*)calloc(g_jobs, sizeof(pid_t));
+  impl_t** worker_impls = (impl_t**)calloc(g_jobs, sizeof(impl_t*));
+  bench_t* benches = (bench_t*)calloc(n_bench, sizeof(bench_t));
+  struct pollfd* pfds = (struct pollfd*)calloc(n_bench + 1, sizeof(struct pollfd));
+  size_t* pfd_bench = (size_t*)calloc(n_bench + 1, sizeof(size_t));
+  struct sigaction sa;
+
+  if (pipe(g_sigchld_fds)) FATAL("could not create pipe");
+  for (i = 0; i < 2; ++i) {
+    set_cloexec(g_sigchld_fds[i]);
+    fcntl(g_sigchld_fds[i], F_SETFL, fcntl(g_sigchld_fds[i], F_GETFL) | O_NONBLOCK);
+  }
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = on_sigchld;
+  sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+  sigaction(SIGCHLD, &sa, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  ensure_tool("generate", "generate.c", NULL, "");
+  if (!g_samples_mode) ensure_tool("bench", "bench.c", g_runtime_deps, " crc32_runtime.c -ldl -lpthread");
+  if (parallel && !g_samples_mode) {
+    g_ref_impl = create_ref_impl();
+    ptr_array_append(&g_impls, (void*)g_ref_impl);
+  }
+  compute_keys();
+  mkdir(g_cache_dir, 0777);
+  if (g_ref_impl) {
+    g_impls.size--;
+    if (!cache_has(g_ref_impl)) {
+      char* cmd = build_command(g_ref_impl);
+      if (run_shell(cmd) != 0) FATAL("could not build reference kernel");
+      free(cmd);
+    }
+    publish(g_ref_impl);
+    for (i = 0; i < g_size_count; ++i) {
+      if (g_sizes[i] > (1u << 20)) fprintf(stderr, "warning: sizes above 1MiB will contend for memory bandwidth between ./bench workers\n");
+    }
+  }
+  for (i = 0; i < n_bench; ++i) benches[i].fd = -1; /* No bench workers in samples mode. */
+  if (!g_samples_mode) {
+    if (!g_fresh) load_journal();
+    for (i = 0; i < n_bench; ++i) {
+      benches[i].pid = spawn_bench(g_bench_cpus[i], &benches[i].to, &benches[i].fd);
+      benches[i].rcap = 16384;
+      benches[i].rbuf = (char*)malloc(benches[i].rcap);
+    }
+    alive = n_bench;
+  }
+  pfds[0].fd = g_sigchld_fds[0];
+  pfds[0].events = POLLIN;
+  for (;;) {
+    size_t n_pfds = 1;
+    while (next < g_impls.size && (alive || g_samples_mode)) {
+      impl_t* impl = (impl_t*)g_impls.contents[next];
+      const char* previous = g_samples_mode ? NULL : journal_lookup(impl);
+      if (previous) {
+        char* line = journal_replay(impl, previous);
+        report(impl, line, 0);
+        free(line);
+      } else if (cache_has(impl)) {
+        publish(impl);
+        if (!g_samples_mode) ready[ready_tail++] = impl;
+      } else if (running < (size_t)g_jobs) {
+        char* cmd = build_command(impl);
+        for (i = 0; worker_pids[i]; ++i) {}
+        worker_pids[i] = spawn_worker(cmd);
+        worker_impls[i] = impl;
+        ++running;
+        free(cmd);
+      } else {
+        break;
+      }
+      ++next;
+    }
+    for (i = 0; i < n_bench; ++i) {
+      /* Hand out work: calibration first, then candidates, with references */
+      /* interleaved. A lone ./bench just gets everything as it is ready. */
+      bench_t* b = &benches[i];
+      if (b->fd < 0) continue;
+      if (parallel && calibrated < n_bench) {
+        if (calibrated == i && b->queue_head == b->queue_tail) bench_send(b, g_ref_impl);
+        continue;
+      }
+      while (ready_head < ready_tail && b->queue_tail - b->queue_head < (parallel ? 1u : BENCH_QUEUE)) {
+        if (parallel && b->since_ref >= REF_INTERVAL) {
+          bench_send(b, g_ref_impl);
+          b->since_ref = 0;
+        } else {
+          bench_send(b, ready[ready_head++]);
+          b->since_ref++;
+        }
+      }
+    }
+    if (!running && next == g_impls.size && ready_head == ready_tail) {
+      for (i = 0; i < n_bench && (benches[i].fd < 0 || benches[i].queue_head == benches[i].queue_tail); ++i) {}
+      if (i == n_bench) break;
+    }
+    if (!alive && !running && !g_samples_mode) break;
+    for (i = 0; i < n_bench; ++i) {
+      if (benches[i].fd < 0) continue;
+      pfds[n_pfds].fd = benches[i].fd;
+      pfds[n_pfds].events = POLLIN;
+      pfd_bench[n_pfds++] = i;
+    }
+    if (poll(pfds, n_pfds, -1) < 0) {
+      if (errno == EINTR) continue;
+      FATAL("poll failed");
+    }
+    if (pfds[0].revents) {
+      char drain[64];
+      while (read(g_sigchld_fds[0], drain, sizeof(drain)) > 0) {}
+      while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        for (i = 0; i < n_bench && benches[i].pid != pid; ++i) {}
+        if (i < n_bench) {
+          /* Output is drained separately, until EOF. */
+          benches[i].pid = -pid;
+          if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failed = 1;
+          continue;
+        }
+        for (i = 0; i < (size_t)g_jobs && worker_pids[i] != pid; ++i) {}
+        if (i == (size_t)g_jobs) continue;
+        worker_pids[i] = 0;
+        --running;
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+          publish(worker_impls[i]);
+          if (alive) ready[ready_tail++] = worker_impls[i];
+        } else {
+          printf("%s%s%scompile error!\n", worker_impls[i]->name, g_samples_mode ? ".c" : g_so_suffix, g_sep);
+          fflush(stdout);
+          failed = 1;
+        }
+      }
+    }
+    for (i = 1; i < n_pfds; ++i) {
+      bench_t* b = &benches[pfd_bench[i]];
+      ssize_t n;
+      char* line;
+      char* eol;
+      if (!pfds[i].revents) continue;
+      if (b->rcap - b->rlen < 4096) {
+        /* A partial line is kept until its newline arrives, however long. */
+        b->rcap *= 2;
+        if (!(b->rbuf = (char*)realloc(b->rbuf, b->rcap))) FATAL("out of memory");
+      }
+      n = read(b->fd, b->rbuf + b->rlen, b->rcap - 1 - b->rlen);
+      if (n <= 0) {
+        if (n < 0 && errno == EINTR) continue;
+        close(b->fd);
+        b->fd = -1;
+        if (b->queue_head != b->queue_tail) failed = 1;
+        --alive;
+        continue;
+      }
+      b->rlen += (size_t)n;
+      b->rbuf[b->rlen] = '\0';
+      for (line = b->rbuf; (eol = strchr(line, '\n')); line = eol + 1) {
+        impl_t* impl = b->queue_head != b->queue_tail ? b->queue[b->queue_head++ % BENCH_QUEUE] : NULL;
+        *eol = '\0';
+        if (impl && impl == g_ref_impl) {
+          /* No rates (e.g. with -r=0) means nothing to normalise. */
+          double* rates = parse_rates(impl, line);
+          if (!rates && line[strlen(line) - 1] == '!') FATAL("reference kernel failed: %s", line);
+          free(b->ref);
+          b->ref = rates;
+          if (!b->calibrated) {
+            b->calibrated = 1;
+            ++calibrated;
+            if (rates) {
+              b->quiet = (double*)malloc(g_size_count * sizeof(double));
+              memcpy(b->quiet, rates, g_size_count * sizeof(double));
+            }
+          }
+        } else if (impl && parallel) {
+          report_normalised(b, &benches[0], impl, line);
+        } else {
+          report(impl, line, 1);
+        }
+      }
+      b->rlen -= (size_t)(line - b->rbuf);
+      memmove(b->rbuf, line, b->rlen);
+    }
+  }
+  if (ready_head != ready_tail) failed = 1;
+  for (i = 0; i < n_bench; ++i) {
+    bench_t* b = &benches[i];
+    if (b->to) fclose(b->to);
+    while (b->fd >= 0) {
+      ssize_t n = read(b->fd, b->rbuf, b->rcap);
+      if (n > 0) fwrite(b->rbuf, 1, (size_t)n, stdout);
+      else if (n == 0 || errno != EINTR) break;
+    }
+    if (b->pid > 0) {
+      while (waitpid(b->pid, &status, 0) < 0) {
+        if (errno != EINTR) FATAL("waitpid failed");
+      }
+      if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failed = 1;
+    }
+    free(b->rbuf);
+  }
+  free(ready);
+  free(benches);
+  free(pfds);
+  free(pfd_bench);
+  free(worker_pids);
+  free(worker_impls);
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static void enter_self_dir(const char* self_path) {
+  /* Candidates are built alongside ./generate and ./bench, wherever they are. */
+  const char* dirsep = strrchr(self_path, '/');
+  if (dirsep && !(dirsep == self_path + 1 && self_path[0] == '.')) {
+    char* dir = (char*)malloc(dirsep - self_path + 2);
+    memcpy(dir, self_path, dirsep - self_path + 1);
+    dir[dirsep - self_path + 1] = '\0';
+    if (chdir(dir)) FATAL("could not chdir to %s", dir);
+    free(dir);
+  }
 }
 
 int main(int argc, const char* const* argv) {
-  init_make_args(argv[0]);
+  const char* env;
+  int result;
+  if ((env = getenv("CC")) && *env) g_cc = env;
+  if ((env = getenv("CCOPT"))) g_ccopt = env;
+  enter_self_dir(argv[0]);
   parse_args(argc, argv);
+  if (g_query) return run_query();
+  if (g_suite) create_suite_impls();
+  create_chain_variants();
+  create_compiler_variants();
+  create_align_variants();
   deduplicate_impls();
-  generate_makefile();
-  exec_make();
-  return 0;
+  setup_sizes();
+  result = run_pipeline();
+  print_objective_ranking();
+  print_crossover_report();
+  print_pareto_report();
+  print_chain_report();
+  print_align_report();
+  print_suite_report();
+  return result;
 }
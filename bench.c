@@ -1,5 +1,12 @@
 /* MIT licensed; see LICENSE.md */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
 #include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
 #include <setjmp.h>
 #include <signal.h>
 #include <stdint.h>
@@ -7,12 +14,25 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
+#include "crc32_runtime.h"
 
 static int      g_check_correctness = 1;
 static uint64_t g_bench_duration    = 200000000u; /* nanoseconds */
-static size_t   g_bench_size        = 512 * 1024; /* bytes */
+static size_t   g_bench_size        = 512 * 1024; /* bytes; the largest of g_bench_sizes */
+static size_t   g_bench_sizes[256]   = {512 * 1024};
+static uint32_t g_bench_size_count  = 1;
 static uint32_t g_bench_rounds      = 5;
 static uint32_t g_bench_misalign    = 63;         /* byte mask */
+static int      g_report_all        = 0;
+static int      g_fd_mode           = 0;
+static int      g_uring_mode        = 0;
+static int      g_column_mode       = 0;
+static int      g_handoff_cpu       = -1;         /* or the writer's CPU, with --handoff */
+static uint32_t g_offload_threads   = 0;
+static uint32_t g_offload_workers   = 1;
+static uint32_t g_parallel_threads  = 0;
+static size_t   g_check_max         = 16 * 1024 * 1024; /* bytes; lengths for check_large */
 
 static void print_help(FILE* f, const char* self) {
 #if defined(__MACH__) && defined(__APPLE__)
@@ -23,14 +43,37 @@ static void print_help(FILE* f, const char* self) {
   if (!self) self = "./bench";
   fprintf(f, "Usage: %s [OPTION]... DYLIB...\n", self);
   fprintf(f, "Benchmark compiled CRC32 implementations.\n");
-  fprintf(f, "Example: %s ./crc32c_s1%s ./crc32k_v4%s\n\n", self, so_suffix, so_suffix);
+  fprintf(f, "Example: %s ./crc32c_s1%s ./crc32k_v4%s\n", self, so_suffix, so_suffix);
+  fprintf(f, "A DYLIB of - reads further paths from stdin, one per line, and\n");
+  fprintf(f, "prints exactly one line of output per path read (ending in ! if it\n");
+  fprintf(f, "could not be loaded, failed a check, or crashed).\n\n");
   fprintf(f, "Options:\n");
   fprintf(f, "  -r, --rounds=N     (default: %u)\n", (unsigned)g_bench_rounds);
   fprintf(f, "  -d, --duration=N   (default: %ums)\n", (unsigned)(g_bench_duration / 1000000u));
-  fprintf(f, "  -s, --size=N       (default: %uKiB)\n", (unsigned)(g_bench_size >> 10));
+  fprintf(f, "  -s, --size=N,N,... (default: %uKiB)\n", (unsigned)(g_bench_size >> 10));
   fprintf(f, "  -f, --format=human|csv\n");
+  fprintf(f, "  -c, --cpu=N        pin to the given CPU\n");
+  fprintf(f, "      --handoff=N    before every call, rewrite the buffer from a thread\n");
+  fprintf(f, "                     pinned to CPU N, so it arrives from that CPU's cache\n");
   fprintf(f, "      --aligned\n");
   fprintf(f, "      --assume-correct\n");
+  fprintf(f, "      --check-max=N  check lengths up to N (default: %uMiB; 0 for only 4KiB)\n", (unsigned)(g_check_max >> 20));
+  fprintf(f, "      --fd           benchmark hashing a pipe: read+CRC, then crc32_fd\n");
+  fprintf(f, "      --uring        benchmark hashing most of a temporary file: pread+CRC,\n");
+  fprintf(f, "                     then crc32_uring\n");
+  fprintf(f, "      --column       benchmark hashing 4-40 byte values: a per-value loop,\n");
+  fprintf(f, "                     then crc32_hash_column (from generate --column)\n");
+  fprintf(f, "      --offload=N    benchmark N threads hashing small jobs: each hashing\n");
+  fprintf(f, "                     its own, then submitting them to crc32_offload\n");
+  fprintf(f, "      --workers=N    worker threads for --offload (default: 1)\n");
+  fprintf(f, "      --parallel=N   benchmark crc32_many_parallel on buffers of mixed\n");
+  fprintf(f, "                     sizes, from 1 to N threads, and report scaling\n");
+  fprintf(f, "\nGiven several sizes, one rate per size is printed, in order.\n");
+  fprintf(f, "With --fd or --uring, each size is a buffer size, and two lines are printed\n");
+  fprintf(f, "per DYLIB.\n");
+  fprintf(f, "With --offload, each size is a job size, and likewise.\n");
+  fprintf(f, "With --parallel, each size is the largest buffer of a set, and two lines\n");
+  fprintf(f, "are printed per thread count: the rate, then its scaling efficiency.\n");
   fprintf(f, "\nSee https://github.com/corsix/fast-crc32/\n");
 }
 
@@ -50,6 +93,15 @@ static void print_help(FILE* f, const char* self) {
 #define NOINLINE
 #endif
 
+/* When paths stream in from stdin (as from autobench), a candidate which */
+/* can't be loaded or fails a check is reported as "NAME: bad impl!" once */
+/* the message is on stderr, and the next path is read. Otherwise, FATAL. */
+static jmp_buf g_catch_signal;
+#define BAD_IMPL_JMP (-1)
+#define BAD_IMPL(fmt, ...) \
+  (g_report_all ? (fprintf(stderr, fmt "\n", ## __VA_ARGS__), fflush(stderr), longjmp(g_catch_signal, BAD_IMPL_JMP)) \
+                : FATAL(fmt, ## __VA_ARGS__))
+
 /* Command line parsing. */
 
 typedef struct cli_arg_t {
@@ -139,6 +191,25 @@ static uint64_t parse_size(const char* value) {
   return result;
 }
 
+static void parse_sizes(const char* value) {
+  char* mut = strdup(value);
+  char* itr = mut;
+  g_bench_size_count = 0;
+  g_bench_size = 0;
+  for (;;) {
+    char* comma = strchr(itr, ',');
+    size_t size;
+    if (comma) *comma = '\0';
+    if (g_bench_size_count == sizeof(g_bench_sizes) / sizeof(g_bench_sizes[0])) FATAL("too many sizes %s", value);
+    size = parse_size(itr);
+    g_bench_sizes[g_bench_size_count++] = size;
+    if (size > g_bench_size) g_bench_size = size;
+    if (!comma) break;
+    itr = comma + 1;
+  }
+  free(mut);
+}
+
 static uint32_t parse_rounds(const char* value) {
   int res = atoi(value);
   if (res <= 0) res = 0;
@@ -147,6 +218,7 @@ static uint32_t parse_rounds(const char* value) {
 
 static const char* g_sep = ": ";
 static const char* g_gb_suffix = " GB/s";
+static const char* g_list_sep = " ";
 
 static void parse_format(const char* value) {
   if (!value || !*value || !strcmp(value, "human")) {
@@ -154,11 +226,34 @@ static void parse_format(const char* value) {
   } else if (!strcmp(value, "csv")) {
     g_sep = ",";
     g_gb_suffix = "";
+    g_list_sep = ",";
   } else {
     FATAL("unknown format %s", value);
   }
 }
 
+static int parse_cpu(const char* option, const char* value) {
+  char* end;
+  long cpu = strtol(value, &end, 10);
+  if (*value < '0' || *value > '9' || *end || cpu > 65535) FATAL("invalid %s %s", option, value);
+#if defined(__linux__)
+  if (cpu >= CPU_SETSIZE) FATAL("invalid %s %s (CPU numbers go up to %d)", option, value, CPU_SETSIZE - 1);
+#endif
+  return (int)cpu;
+}
+
+static void pin_cpu(const char* value) {
+#if defined(__linux__)
+  cpu_set_t cpus;
+  int cpu = parse_cpu("--cpu", value);
+  CPU_ZERO(&cpus);
+  CPU_SET(cpu, &cpus);
+  if (sched_setaffinity(0, sizeof(cpus), &cpus)) FATAL("could not pin to cpu %d", cpu);
+#else
+  (void)value;
+#endif
+}
+
 typedef uint32_t (*crc_fn_t)(uint32_t, const char*, size_t);
 
 static const char** parse_args(int argc, const char* const* argv) {
@@ -166,7 +261,13 @@ static const char** parse_args(int argc, const char* const* argv) {
   DEF_ARG(duration, "-d") \
   DEF_ARG(size, "-s") \
   DEF_ARG(rounds, "-r") \
-  DEF_ARG(format, "-f")
+  DEF_ARG(format, "-f") \
+  DEF_ARG(cpu, "-c") \
+  DEF_ARG(handoff, "--handoff") \
+  DEF_ARG(offload, "--offload") \
+  DEF_ARG(workers, "--workers") \
+  DEF_ARG(parallel, "--parallel") \
+  DEF_ARG(check_max, "--check-max")
 #define DEF_ARG(name, ...) static const char* name##_spellings[] = {"--" #name, __VA_ARGS__, NULL};
   ARGS
 #undef DEF_ARG
@@ -182,10 +283,13 @@ static const char** parse_args(int argc, const char* const* argv) {
 
   for (i = 1; i < argc; ++i) {
     const char* arg = argv[i];
-    if (arg[0] == '-' && !seen_dash_dash) {
+    if (arg[0] == '-' && arg[1] && !seen_dash_dash) {
       if (!strcmp(arg, "--")) seen_dash_dash = 1;
       else if (!strcmp(arg, "--assume-correct")) g_check_correctness = 0;
       else if (!strcmp(arg, "--aligned")) g_bench_misalign = 0;
+      else if (!strcmp(arg, "--fd")) g_fd_mode = 1;
+      else if (!strcmp(arg, "--uring")) g_uring_mode = 1;
+      else if (!strcmp(arg, "--column")) g_column_mode = 1;
       else if (!strcmp(arg, "--help") || !strcmp(arg, "-h") || !strcmp(arg, "-?")) {
         print_help(stdout, argv[0]);
         exit(0);
@@ -212,8 +316,14 @@ static const char** parse_args(int argc, const char* const* argv) {
   paths[n_paths] = NULL;
 
   if (a_duration.value) g_bench_duration = parse_duration(a_duration.value);
-  if (a_size.value) g_bench_size = parse_size(a_size.value);
+  if (a_size.value) parse_sizes(a_size.value);
   if (a_rounds.value) g_bench_rounds = parse_rounds(a_rounds.value);
+  if (a_cpu.value) pin_cpu(a_cpu.value);
+  if (a_handoff.value) g_handoff_cpu = parse_cpu("--handoff", a_handoff.value);
+  if (a_offload.value && !(g_offload_threads = (uint32_t)atoi(a_offload.value))) FATAL("invalid --offload %s", a_offload.value);
+  if (a_workers.value && !(g_offload_workers = (uint32_t)atoi(a_workers.value))) FATAL("invalid --workers %s", a_workers.value);
+  if (a_check_max.value) g_check_max = (size_t)parse_size(a_check_max.value);
+  if (a_parallel.value && !(g_parallel_threads = (uint32_t)atoi(a_parallel.value))) FATAL("invalid --parallel %s", a_parallel.value);
   parse_format(a_format.value);
   return paths;
 }
@@ -225,38 +335,127 @@ static char* g_buf;
 
 #define CHECK_BUF_SIZE (4096+64)
 
+static void rand_fill(char* buf, size_t n) {
+  size_t i;
+  for (i = 0; i < n; ++i) {
+    buf[i] = rand();
+  }
+}
+
+static uint32_t g_check_table[256];
+static uint32_t g_check_poly = 0;
+
+static uint32_t table_crc(uint32_t crc, const char* buf, size_t len) {
+  /* The reference: one byte at a time, with a table for g_check_poly. */
+  crc = ~crc;
+  while (len--) crc = (crc >> 8) ^ g_check_table[(crc ^ *buf++) & 0xFF];
+  return ~crc;
+}
+
+/* Large lengths. */
+/* Checking every split of every length is quadratic, so lengths above
+** CHECK_BUF_SIZE get a few dozen random trials instead, with a random
+** start, split, and crc0 each. The reference CRC of any stretch of the
+** buffer is combined from two prefix CRCs (as fn(0, B) = fn(0, AB) ^
+** (fn(0, A) shifted by B), which crc32_combine computes), and the prefix
+** CRC at every 4KiB boundary is found once per polynomial by table_crc. */
+
+#define CHECK_LARGE_TRIALS 48
+#define CHECK_LARGE_BLOCK 4096
+
+static char* g_large_buf;
+static uint32_t* g_large_prefix; /* g_large_prefix[i] is fn(0, g_large_buf, i * CHECK_LARGE_BLOCK) */
+static uint32_t g_large_poly = 0;
+
+static uint32_t large_prefix(uint64_t end) {
+  uint64_t block = end / CHECK_LARGE_BLOCK;
+  return table_crc(g_large_prefix[block], g_large_buf + block * CHECK_LARGE_BLOCK, (size_t)(end % CHECK_LARGE_BLOCK));
+}
+
+static void check_large(const char* name, crc_fn_t fn) {
+  size_t size = g_check_max + 64, i, n_blocks = size / CHECK_LARGE_BLOCK;
+  uint32_t trial, octaves = 0;
+  crc32_kernel_t k;
+  crc32_kernel_init(&k, fn);
+  if (!g_large_buf) {
+    g_large_buf = malloc(size);
+    g_large_prefix = malloc((n_blocks + 1) * sizeof(uint32_t));
+    if (!g_large_buf || !g_large_prefix) FATAL("out of memory");
+    rand_fill(g_large_buf, size);
+  }
+  if (g_large_poly != g_check_poly) {
+    g_large_poly = g_check_poly;
+    g_large_prefix[0] = 0;
+    for (i = 0; i < n_blocks; ++i) {
+      g_large_prefix[i + 1] = table_crc(g_large_prefix[i], g_large_buf + i * CHECK_LARGE_BLOCK, CHECK_LARGE_BLOCK);
+    }
+  }
+  while (octaves < 63 && ((size_t)CHECK_BUF_SIZE << (octaves + 1)) <= g_check_max) ++octaves;
+  for (trial = 0; trial < CHECK_LARGE_TRIALS; ++trial) {
+    size_t len, start, split;
+    uint32_t crc0 = (uint32_t)rand() * 2654435761u + (uint32_t)rand(), expected, actual;
+    if (trial == 0) {
+      len = g_check_max;
+    } else if (trial & 1) {
+      /* Anywhere, spread evenly over the octaves. */
+      size_t lo = (size_t)CHECK_BUF_SIZE << (rand() % (octaves + 1));
+      len = lo + (size_t)rand() % lo;
+    } else {
+      /* Just either side of a multiple of a large power of two, where the
+      ** main loop of a kernel with a big k, and what follows it, change. */
+      size_t m = (size_t)CHECK_LARGE_BLOCK << (rand() % (octaves + 1));
+      len = m * (1 + (size_t)rand() % (g_check_max / m + 1)) + (size_t)(rand() % 7) - 3;
+    }
+    if (len > g_check_max) len = g_check_max;
+    if (len < CHECK_BUF_SIZE) len = CHECK_BUF_SIZE;
+    start = (size_t)rand() % (size - len + 1);
+    split = (size_t)rand() % (len + 1);
+    expected = crc32_combine(&k, large_prefix(start), large_prefix(start + len), len);
+    expected = crc32_combine(&k, crc0, expected, len);
+    actual = fn(crc0, g_large_buf + start, len);
+    if (UNLIKELY(actual != expected)) {
+      BAD_IMPL("bad impl %s (expected %08x but got %08x for %zu bytes at offset %zu)", name,
+        (unsigned)expected, (unsigned)actual, len, start);
+    }
+    actual = fn(fn(crc0, g_large_buf + start, split), g_large_buf + start + split, len - split);
+    if (UNLIKELY(actual != expected)) {
+      BAD_IMPL("bad impl %s (expected %08x but got %08x for %zu bytes at offset %zu, split at byte %zu)", name,
+        (unsigned)expected, (unsigned)actual, len, start, split);
+    }
+  }
+}
+
 static void check_impl(const char* name, crc_fn_t fn) {
-  static uint32_t table[256] = {0};
-  static uint32_t table_poly = 0;
   uint32_t i, entire, expected = ~(uint32_t)0;
   /* Build a table for checking this fn. */
   uint32_t poly = ~fn(~(uint32_t)0, "\x80", 1);
-  if (poly != table_poly) {
-    table_poly = poly;
+  if (poly != g_check_poly) {
+    g_check_poly = poly;
     for (i = 0; i < 256; ++i) {
       uint32_t crc = i, j;
       for (j = 0; j < 8; ++j) {
         crc = (crc >> 1) ^ ((crc & 1) * poly);
       }
-      table[i] = crc;
+      g_check_table[i] = crc;
     }
   }
   /* Actually check this fn. */
   entire = fn(0, g_buf, CHECK_BUF_SIZE);
   for (i = 0; i < CHECK_BUF_SIZE; ) {
     uint32_t actual = fn(0, g_buf, i + 1);
-    expected = (expected >> 8) ^ table[(expected ^ g_buf[i]) & 0xFF];
+    expected = (expected >> 8) ^ g_check_table[(expected ^ g_buf[i]) & 0xFF];
     ++i;
     if (UNLIKELY(~expected != actual)) {
-      FATAL("bad impl %s (expected %08x but got %08x for %d bytes)", name,
+      BAD_IMPL("bad impl %s (expected %08x but got %08x for %d bytes)", name,
         (unsigned)~expected, (unsigned)actual, (int)i);
     }
     actual = fn(actual, g_buf + i, CHECK_BUF_SIZE - i);
     if (UNLIKELY(actual != entire)) {
-      FATAL("bad impl %s (whole buffer gives %08x, but split at byte %d gives %08x)", name,
+      BAD_IMPL("bad impl %s (whole buffer gives %08x, but split at byte %d gives %08x)", name,
         (unsigned)entire, (int)i, (unsigned)actual);
     }
   }
+  if (g_check_max > CHECK_BUF_SIZE) check_large(name, fn);
 }
 
 /* Actual benchmarking logic. */
@@ -304,18 +503,599 @@ static NOINLINE double bench_fn(crc_fn_t fn, char* buf, size_t size) {
   }
 }
 
+/* Producer-consumer handoff, with --handoff. */
+/* In a pipeline, one core writes a buffer and another checksums it, so the
+** lines which the CRC loads are Modified in the writer's cache, and each
+** miss is a snoop to that core rather than a hit in our own cache. A writer
+** thread recreates this by rewriting the buffer before every call. Only the
+** calls themselves are timed. */
+
+typedef struct handoff_t {
+  uint64_t* buf;
+  size_t words;
+  uint32_t written;  /* Number of rewrites completed. */
+  uint32_t consumed; /* Number of calls completed. */
+  int stop;
+} handoff_t;
+
+/* Not on bench_handoff_fn's stack, as SIGILL or SIGSEGV from the impl can */
+/* longjmp out of it, and then main stops the writer via stop_handoff. */
+static handoff_t g_handoff;
+static pthread_t g_handoff_writer;
+static int g_handoff_running = 0;
+
+static void* handoff_writer(void* arg) {
+  handoff_t* h = (handoff_t*)arg;
+  uint32_t seq = 0;
+  size_t i;
+#if defined(__linux__)
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(g_handoff_cpu, &cpus);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus)) FATAL("could not pin to cpu %d", g_handoff_cpu);
+#endif
+  for (;;) {
+    while (__atomic_load_n(&h->consumed, __ATOMIC_ACQUIRE) != seq) {
+      if (__atomic_load_n(&h->stop, __ATOMIC_ACQUIRE)) return NULL;
+      sched_yield();
+    }
+    for (i = 0; i < h->words; ++i) {
+      h->buf[i] += 0x9e3779b97f4a7c15ull;
+    }
+    __atomic_store_n(&h->written, ++seq, __ATOMIC_RELEASE);
+  }
+}
+
+static void stop_handoff(void) {
+  if (!g_handoff_running) return;
+  __atomic_store_n(&g_handoff.stop, 1, __ATOMIC_RELEASE);
+  pthread_join(g_handoff_writer, NULL);
+  g_handoff_running = 0;
+}
+
+static NOINLINE double bench_handoff_fn(crc_fn_t fn, char* buf, size_t size) {
+  handoff_t* h = &g_handoff;
+  uint32_t i = 0, misalign = g_bench_misalign;
+  uint32_t crc = fn(0, NULL, 0);
+  uint64_t t0, elapsed = 0, limit = now() + g_bench_duration * 16;
+  h->buf = (uint64_t*)buf;
+  h->words = (size + g_bench_misalign) / 8;
+  h->written = h->consumed = 0;
+  h->stop = 0;
+  if (pthread_create(&g_handoff_writer, NULL, handoff_writer, h)) FATAL("could not create thread");
+  g_handoff_running = 1;
+  do {
+    while (__atomic_load_n(&h->written, __ATOMIC_ACQUIRE) == i) {
+      sched_yield(); /* Untimed, and lets this work with both threads on one CPU. */
+    }
+    t0 = now();
+    crc = fn(crc, buf + (i & misalign), size);
+    elapsed += now() - t0;
+    __atomic_store_n(&h->consumed, ++i, __ATOMIC_RELEASE);
+  } while (elapsed < g_bench_duration && t0 < limit);
+  stop_handoff();
+  g_sink = crc;
+  return (double)((uint64_t)i * size) / (double)elapsed;
+}
+
 static void bench_impl(const char* name, crc_fn_t fn) {
   char* ptr = g_buf;
   if (!g_bench_misalign) {
     ptr = ptr + 64 - (63 & (uintptr_t)ptr);
   }
-  double best = 0.;
-  uint32_t r = g_bench_rounds;
+  double best[sizeof(g_bench_sizes) / sizeof(g_bench_sizes[0])] = {0.};
+  uint32_t r = g_bench_rounds, i;
   do {
-    double rate = bench_fn(fn, ptr, g_bench_size);
-    if (rate > best) best = rate;
+    for (i = 0; i < g_bench_size_count; ++i) {
+      double rate = (g_handoff_cpu >= 0 ? bench_handoff_fn : bench_fn)(fn, ptr, g_bench_sizes[i]);
+      if (rate > best[i]) best[i] = rate;
+    }
   } while (--r);
-  printf("%s%s%.2f%s\n", name, g_sep, best, g_gb_suffix);
+  printf("%s", name);
+  for (i = 0; i < g_bench_size_count; ++i) {
+    printf("%s%.2f", i ? g_list_sep : g_sep, best[i]);
+  }
+  printf("%s\n", g_gb_suffix);
+}
+
+/* T10-DIF kernels, from ./generate -p t10dif, export t10dif_* rather than
+** crc32_impl. They are checked against a bitwise reference, and benchmarked
+** as t10dif_verify over interleaved sectors (so bytes/s includes the tuples,
+** and only whole sectors count). */
+
+typedef struct t10dif_fns_t {
+  size_t (*sector_size)(void);
+  uint32_t (*crc)(uint32_t, const char*, size_t);
+  void (*generate)(const char*, size_t, char*, size_t, size_t);
+  size_t (*verify)(const char*, size_t, const char*, size_t, size_t, uint64_t*);
+} t10dif_fns_t;
+
+static t10dif_fns_t g_t10dif;
+
+static uint32_t t10dif_reference(const char* buf, size_t len) {
+  uint32_t crc = 0, i;
+  for (; len; --len) {
+    crc ^= (uint32_t)(uint8_t)*buf++ << 8;
+    for (i = 0; i < 8; ++i) {
+      crc = ((crc << 1) ^ ((crc >> 15) * 0x8BB7)) & 0xFFFF;
+    }
+  }
+  return crc;
+}
+
+static uint32_t t10dif_stored(const char* pi) {
+  return ((uint32_t)(uint8_t)pi[0] << 8) | (uint8_t)pi[1];
+}
+
+static void check_t10dif(const char* name) {
+  size_t sector = g_t10dif.sector_size(), stride = sector + 8, n = 70, i;
+  char* buf = malloc(n * stride);
+  char pi[70 * 8];
+  uint64_t bitmap[2];
+  uint32_t actual = g_t10dif.crc(0, "123456789", 9);
+  if (UNLIKELY(actual != 0xd0db)) BAD_IMPL("bad impl %s (expected d0db but got %04x for 123456789)", name, (unsigned)actual);
+  rand_fill(buf, n * stride);
+  g_t10dif.generate(buf, stride, buf + sector, stride, n);
+  g_t10dif.generate(buf, stride, pi, 8, n);
+  for (i = 0; i < n; ++i) {
+    uint32_t expected = t10dif_reference(buf + i * stride, sector);
+    actual = t10dif_stored(buf + i * stride + sector);
+    if (UNLIKELY(actual != expected || t10dif_stored(pi + i * 8) != expected)) {
+      BAD_IMPL("bad impl %s (expected guard %04x but got %04x for sector %d)", name, (unsigned)expected, (unsigned)actual, (int)i);
+    }
+  }
+  if (UNLIKELY(g_t10dif.verify(buf, stride, buf + sector, stride, n, bitmap) || bitmap[0] || bitmap[1])) {
+    BAD_IMPL("bad impl %s (verify rejects what generate produced)", name);
+  }
+  buf[3 * stride + 17] ^= 1;
+  buf[65 * stride] ^= 0x80;
+  if (UNLIKELY(g_t10dif.verify(buf, stride, buf + sector, stride, n, bitmap) != 2 || bitmap[0] != 8 || bitmap[1] != 2)) {
+    BAD_IMPL("bad impl %s (verify misreports corrupted sectors)", name);
+  }
+  free(buf);
+}
+
+static uint32_t t10dif_bench_fn(uint32_t crc, const char* buf, size_t len) {
+  size_t sector = g_t10dif.sector_size();
+  return crc + (uint32_t)g_t10dif.verify(buf, sector + 8, buf + sector, sector + 8, len / (sector + 8), NULL);
+}
+
+/* Column hashing, for libraries with crc32_hash_column. */
+/* The column is a fixed set of values of 4 to 40 bytes, in Arrow layout. */
+
+typedef void (*column_fn_t)(const char*, const int32_t*, size_t, uint32_t*);
+
+#define COLUMN_VALUES 65536
+
+static char* g_column_data;
+static int32_t* g_column_offsets;
+static uint32_t* g_column_out;
+
+static void make_column(void) {
+  uint32_t i;
+  if (g_column_data) return;
+  g_column_data = malloc(COLUMN_VALUES * 40);
+  g_column_offsets = malloc((COLUMN_VALUES + 1) * sizeof(int32_t));
+  g_column_out = malloc(COLUMN_VALUES * sizeof(uint32_t));
+  rand_fill(g_column_data, COLUMN_VALUES * 40);
+  g_column_offsets[0] = 0;
+  for (i = 0; i < COLUMN_VALUES; ++i) {
+    g_column_offsets[i + 1] = g_column_offsets[i] + 4 + rand() % 37;
+  }
+}
+
+static void check_column(const char* name, crc_fn_t fn, column_fn_t column_fn) {
+  uint32_t i, n;
+  make_column();
+  for (n = 0; n < 40; ++n) {
+    /* Every count up to a few multiples of the interleave, then lots. */
+    uint32_t count = n < 39 ? n : COLUMN_VALUES - 1;
+    column_fn(g_column_data + 1, g_column_offsets + 1, count, g_column_out);
+    for (i = 0; i < count; ++i) {
+      int32_t len = g_column_offsets[i + 2] - g_column_offsets[i + 1];
+      uint32_t expected = fn(0, g_column_data + 1 + g_column_offsets[i + 1], len);
+      if (UNLIKELY(g_column_out[i] != expected)) {
+        BAD_IMPL("bad impl %s (crc32_hash_column gives %08x for value %d of %d, rather than %08x)", name,
+          (unsigned)g_column_out[i], (int)i, (int)count, (unsigned)expected);
+      }
+    }
+  }
+}
+
+static void check_many(const char* name, crc_fn_t fn, crc32_many_fn_t many_fn) {
+  /* Unrelated buffers of 0 to 1023 bytes, each continuing its own crc. */
+  uint32_t crcs[40], init[40], i, n;
+  const char* bufs[40];
+  size_t lens[40];
+  for (n = 0; n < 40; ++n) {
+    for (i = 0; i < n; ++i) {
+      bufs[i] = g_buf + rand() % 64;
+      lens[i] = rand() % 1024;
+      crcs[i] = init[i] = (uint32_t)rand();
+    }
+    many_fn(crcs, bufs, lens, n);
+    for (i = 0; i < n; ++i) {
+      uint32_t expected = fn(init[i], bufs[i], lens[i]);
+      if (UNLIKELY(crcs[i] != expected)) {
+        BAD_IMPL("bad impl %s (crc32_hash_many gives %08x for buffer %d of %d, rather than %08x)", name,
+          (unsigned)crcs[i], (int)i, (int)n, (unsigned)expected);
+      }
+    }
+  }
+}
+
+static double bench_column(crc_fn_t fn, column_fn_t column_fn) {
+  /* Returns millions of values per second. */
+  uint64_t t0 = now(), elapsed;
+  uint32_t reps = 0, i;
+  do {
+    if (column_fn) {
+      column_fn(g_column_data, g_column_offsets, COLUMN_VALUES, g_column_out);
+    } else {
+      for (i = 0; i < COLUMN_VALUES; ++i) {
+        g_column_out[i] = fn(0, g_column_data + g_column_offsets[i], g_column_offsets[i + 1] - g_column_offsets[i]);
+      }
+    }
+    ++reps;
+    barrier;
+  } while ((elapsed = now() - t0) < g_bench_duration);
+  g_sink = g_column_out[reps % COLUMN_VALUES];
+  return (double)reps * COLUMN_VALUES * 1e3 / (double)elapsed;
+}
+
+static void bench_column_impl(const char* name, crc_fn_t fn, column_fn_t column_fn) {
+  static const char* const suffixes[2] = {" (per-value)", " (column)"};
+  const char* unit = *g_gb_suffix ? " Mvalues/s" : "";
+  uint32_t which, r;
+  make_column();
+  for (which = 0; which < 2; ++which) {
+    double best = 0.;
+    for (r = 0; r < g_bench_rounds; ++r) {
+      double rate = bench_column(fn, which ? column_fn : NULL);
+      if (rate > best) best = rate;
+    }
+    printf("%s%s%s%.2f%s\n", name, suffixes[which], g_sep, best, unit);
+  }
+}
+
+/* Hashing from a file descriptor, with --fd. */
+/* A writer thread fills a pipe for as long as it stays open, and the data is
+** hashed either serially (read into a buffer, then CRC it, then repeat) or by
+** crc32_fd (which overlaps the two using a reader thread). */
+
+static char* g_pipe_buf;
+#define PIPE_BUF_SIZE (64 * 1024)
+
+static void* pipe_writer(void* arg) {
+  int fd = (int)(intptr_t)arg;
+  for (;;) {
+    ssize_t n = write(fd, g_pipe_buf, PIPE_BUF_SIZE);
+    if (n < 0 && errno != EINTR) break;
+  }
+  close(fd);
+  return NULL;
+}
+
+static uint64_t hash_pipe(crc32_kernel_t* k, int overlap, size_t size, uint64_t volume) {
+  /* Returns the elapsed nanoseconds to hash volume bytes. */
+  int fds[2];
+  pthread_t writer;
+  uint64_t t0, elapsed, got = 0;
+  uint32_t crc = 0;
+  if (pipe(fds)) FATAL("could not create pipe");
+#if defined(F_SETPIPE_SZ)
+  fcntl(fds[1], F_SETPIPE_SZ, 1024 * 1024);
+#endif
+  if (pthread_create(&writer, NULL, pipe_writer, (void*)(intptr_t)fds[1])) FATAL("could not create thread");
+  t0 = now();
+  if (overlap) {
+    if (crc32_fd(k, fds[0], volume, size, &crc, &got)) FATAL("crc32_fd failed");
+  } else {
+    while (got < volume) {
+      ssize_t n = read(fds[0], g_buf, volume - got < size ? (size_t)(volume - got) : size);
+      if (n > 0) {
+        crc = k->fn(crc, g_buf, (size_t)n);
+        got += (uint64_t)n;
+      } else if (n == 0 || errno != EINTR) {
+        break;
+      }
+    }
+  }
+  elapsed = now() - t0;
+  if (got != volume) FATAL("short read from pipe");
+  g_sink = crc;
+  close(fds[0]); /* The writer then gets EPIPE, and stops. */
+  pthread_join(writer, NULL);
+  return elapsed;
+}
+
+static double bench_fd(crc32_kernel_t* k, int overlap, size_t size) {
+  uint64_t volume = 16 * 1024 * 1024, elapsed;
+  for (;;) {
+    elapsed = hash_pipe(k, overlap, size, volume);
+    if (elapsed > g_bench_duration || volume >= ((uint64_t)1 << 40)) break;
+    volume *= 2;
+  }
+  return (double)volume / (double)elapsed;
+}
+
+static void bench_fd_impl(const char* name, crc_fn_t fn) {
+  static const char* const suffixes[2] = {" (read+crc)", " (crc32_fd)"};
+  crc32_kernel_t k;
+  uint32_t overlap, r, i;
+  if (!g_pipe_buf) {
+    g_pipe_buf = malloc(PIPE_BUF_SIZE);
+    memset(g_pipe_buf, 0x5a, PIPE_BUF_SIZE);
+    signal(SIGPIPE, SIG_IGN);
+  }
+  crc32_kernel_init(&k, fn);
+  for (overlap = 0; overlap < 2; ++overlap) {
+    double best[sizeof(g_bench_sizes) / sizeof(g_bench_sizes[0])] = {0.};
+    for (r = 0; r < g_bench_rounds; ++r) {
+      for (i = 0; i < g_bench_size_count; ++i) {
+        double rate = bench_fd(&k, overlap, g_bench_sizes[i]);
+        if (rate > best[i]) best[i] = rate;
+      }
+    }
+    printf("%s%s", name, suffixes[overlap]);
+    for (i = 0; i < g_bench_size_count; ++i) {
+      printf("%s%.2f", i ? g_list_sep : g_sep, best[i]);
+    }
+    printf("%s\n", g_gb_suffix);
+  }
+}
+
+/* Hashing a file, with --uring. */
+/* A temporary file is hashed bar its last byte, so that the length is not a
+** multiple of any buffer size, either serially (pread into a buffer, then
+** CRC it) or by crc32_uring (with URING_DEPTH reads in flight). Every result
+** is checked against the CRC of the same bytes in memory. */
+
+#define URING_FILE_SIZE (16 * 1024 * 1024 + 4097)
+#define URING_DEPTH 8
+
+static int g_uring_fd = -1;
+static char* g_uring_data;
+
+static uint32_t hash_file(crc32_kernel_t* k, int overlap, size_t size, uint64_t len) {
+  uint64_t got = 0;
+  uint32_t crc = 0;
+  int err;
+  if (overlap) {
+    if ((err = crc32_uring(k, g_uring_fd, len, URING_DEPTH, size, &crc))) FATAL("crc32_uring failed: %s", strerror(err));
+    return crc;
+  }
+  while (got < len) {
+    ssize_t n = pread(g_uring_fd, g_buf, len - got < size ? (size_t)(len - got) : size, (off_t)got);
+    if (n > 0) {
+      crc = k->fn(crc, g_buf, (size_t)n);
+      got += (uint64_t)n;
+    } else if (n == 0 || errno != EINTR) {
+      FATAL("short read from temporary file");
+    }
+  }
+  return crc;
+}
+
+static double bench_uring(crc32_kernel_t* k, int overlap, size_t size, uint32_t expected) {
+  uint64_t len = URING_FILE_SIZE - 1, volume = 0, t0 = now(), elapsed;
+  do {
+    uint32_t crc = hash_file(k, overlap, size, len);
+    if (crc != expected) FATAL("hashing %llu bytes in %zu byte reads gave %08x rather than %08x", (unsigned long long)len, size, crc, expected);
+    volume += len;
+  } while ((elapsed = now() - t0) < g_bench_duration);
+  return (double)volume / (double)elapsed;
+}
+
+static void bench_uring_impl(const char* name, crc_fn_t fn) {
+  static const char* const suffixes[2] = {" (pread+crc)", " (crc32_uring)"};
+  crc32_kernel_t k;
+  uint32_t overlap, r, i, expected, crc;
+  if (g_uring_fd < 0) {
+    char path[] = "/tmp/crc32_bench_XXXXXX";
+    if ((g_uring_fd = mkstemp(path)) < 0) FATAL("could not create temporary file");
+    unlink(path);
+    g_uring_data = malloc(URING_FILE_SIZE);
+    rand_fill(g_uring_data, URING_FILE_SIZE);
+    if (write(g_uring_fd, g_uring_data, URING_FILE_SIZE) != URING_FILE_SIZE) FATAL("could not write temporary file");
+  }
+  crc32_kernel_init(&k, fn);
+  expected = fn(0, g_uring_data, URING_FILE_SIZE - 1);
+  for (overlap = 0; overlap < 2; ++overlap) {
+    double best[sizeof(g_bench_sizes) / sizeof(g_bench_sizes[0])] = {0.};
+    if (overlap && crc32_uring(&k, g_uring_fd, 1, 1, 4096, &crc) == ENOSYS) {
+      fprintf(stderr, "%s: io_uring is unavailable, so not benchmarking crc32_uring\n", name);
+      break;
+    }
+    for (r = 0; r < g_bench_rounds; ++r) {
+      for (i = 0; i < g_bench_size_count; ++i) {
+        double rate = bench_uring(&k, overlap, g_bench_sizes[i], expected);
+        if (rate > best[i]) best[i] = rate;
+      }
+    }
+    printf("%s%s", name, suffixes[overlap]);
+    for (i = 0; i < g_bench_size_count; ++i) {
+      printf("%s%.2f", i ? g_list_sep : g_sep, best[i]);
+    }
+    printf("%s\n", g_gb_suffix);
+  }
+}
+
+/* Offloading small jobs, with --offload=N. */
+/* N submitting threads each keep OFFLOAD_INFLIGHT jobs of one size in
+** flight, and either hash them inline or hand them to a crc32_offload engine
+** with g_offload_workers workers (and crc32_hash_many, if the library has
+** it). Every result is checked, and the rate is that of all N together. */
+
+#define OFFLOAD_INFLIGHT 32
+
+typedef struct offload_bench_t {
+  const crc32_kernel_t* k;
+  crc32_offload_t* engine; /* or NULL, to hash inline */
+  size_t size;
+  uint64_t deadline;
+  uint64_t bytes;
+  uint32_t expected[OFFLOAD_INFLIGHT];
+} offload_bench_t;
+
+static void* offload_submitter(void* arg) {
+  offload_bench_t* b = (offload_bench_t*)arg;
+  crc32_offload_ring_t* ring = NULL;
+  crc32_job_t jobs[OFFLOAD_INFLIGHT];
+  uint64_t bytes = 0;
+  uint32_t i;
+  if (b->engine && crc32_offload_ring(b->engine, &ring)) FATAL("could not create offload ring");
+  do {
+    for (i = 0; i < OFFLOAD_INFLIGHT; ++i) {
+      jobs[i].buf = g_buf + i;
+      jobs[i].len = b->size;
+      jobs[i].crc = 0;
+      if (!ring) jobs[i].crc = b->k->fn(0, jobs[i].buf, jobs[i].len);
+      else if (crc32_offload_submit(ring, jobs + i)) FATAL("offload ring full");
+    }
+    for (i = 0; i < OFFLOAD_INFLIGHT; ++i) {
+      if (ring) crc32_offload_wait(jobs + i);
+      if (UNLIKELY(jobs[i].crc != b->expected[i])) {
+        FATAL("offloaded job gives %08x, rather than %08x", (unsigned)jobs[i].crc, (unsigned)b->expected[i]);
+      }
+    }
+    bytes += OFFLOAD_INFLIGHT * b->size;
+  } while (now() < b->deadline);
+  __atomic_add_fetch(&b->bytes, bytes, __ATOMIC_RELAXED);
+  return NULL;
+}
+
+static double bench_offload(const crc32_kernel_t* k, crc32_many_fn_t many_fn, int offload, size_t size) {
+  offload_bench_t b;
+  pthread_t* threads = malloc(g_offload_threads * sizeof(pthread_t));
+  uint64_t t0;
+  uint32_t i;
+  memset(&b, 0, sizeof(b));
+  b.k = k;
+  b.size = size;
+  for (i = 0; i < OFFLOAD_INFLIGHT; ++i) {
+    b.expected[i] = k->fn(0, g_buf + i, size);
+  }
+  if (offload && crc32_offload_start(&b.engine, k, many_fn, 0, g_offload_workers, NULL, 0)) {
+    FATAL("could not start offload engine");
+  }
+  t0 = now();
+  b.deadline = t0 + g_bench_duration;
+  for (i = 0; i < g_offload_threads; ++i) {
+    if (pthread_create(threads + i, NULL, offload_submitter, &b)) FATAL("could not create thread");
+  }
+  for (i = 0; i < g_offload_threads; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+  t0 = now() - t0;
+  if (b.engine) crc32_offload_stop(b.engine);
+  free(threads);
+  return (double)b.bytes / (double)t0;
+}
+
+static void bench_offload_impl(const char* name, crc_fn_t fn, crc32_many_fn_t many_fn) {
+  static const char* const suffixes[2] = {" (inline)", " (offload)"};
+  crc32_kernel_t k;
+  uint32_t offload, r, i;
+  crc32_kernel_init(&k, fn);
+  for (offload = 0; offload < 2; ++offload) {
+    double best[sizeof(g_bench_sizes) / sizeof(g_bench_sizes[0])] = {0.};
+    for (r = 0; r < g_bench_rounds; ++r) {
+      for (i = 0; i < g_bench_size_count; ++i) {
+        double rate = bench_offload(&k, many_fn, offload, g_bench_sizes[i]);
+        if (rate > best[i]) best[i] = rate;
+      }
+    }
+    printf("%s%s", name, suffixes[offload]);
+    for (i = 0; i < g_bench_size_count; ++i) {
+      printf("%s%.2f", i ? g_list_sep : g_sep, best[i]);
+    }
+    printf("%s\n", g_gb_suffix);
+  }
+}
+
+/* Hashing many buffers of mixed sizes, with --parallel=N. */
+/* A set of PARALLEL_BUFS buffers, of sizes spread evenly over the octaves
+** from 1 byte up to the given size, all overlapping within g_buf, is hashed
+** by crc32_many_parallel with 1, 2, 4, ... threads, up to N. Scaling
+** efficiency is the rate with t threads over t times the rate with 1. */
+
+#define PARALLEL_BUFS 4096
+
+static const char* g_parallel_bufs[PARALLEL_BUFS];
+static size_t g_parallel_lens[PARALLEL_BUFS];
+static uint32_t g_parallel_crcs[PARALLEL_BUFS];
+
+static uint64_t make_parallel_set(size_t max) {
+  uint64_t total = 0;
+  uint32_t i, octaves = 1;
+  while (octaves < 63 && ((size_t)1 << octaves) <= max) ++octaves;
+  for (i = 0; i < PARALLEL_BUFS; ++i) {
+    size_t lo = (size_t)1 << (i % octaves), len = lo + ((size_t)rand() % lo);
+    g_parallel_bufs[i] = g_buf + (rand() & 63);
+    g_parallel_lens[i] = len < max ? len : max;
+    total += g_parallel_lens[i];
+  }
+  return total;
+}
+
+static void check_parallel(const crc32_kernel_t* k, crc32_many_fn_t many_fn, uint32_t threads) {
+  uint32_t i;
+  for (i = 0; i < PARALLEL_BUFS; ++i) g_parallel_crcs[i] = i;
+  if (crc32_many_parallel(k, many_fn, g_parallel_crcs, g_parallel_bufs, g_parallel_lens, PARALLEL_BUFS, threads, 0)) {
+    FATAL("crc32_many_parallel failed");
+  }
+  for (i = 0; i < PARALLEL_BUFS; ++i) {
+    uint32_t expected = k->fn(i, g_parallel_bufs[i], g_parallel_lens[i]);
+    if (UNLIKELY(g_parallel_crcs[i] != expected)) {
+      FATAL("crc32_many_parallel gives %08x for buffer %u of %zu bytes, rather than %08x", (unsigned)g_parallel_crcs[i],
+        (unsigned)i, g_parallel_lens[i], (unsigned)expected);
+    }
+  }
+}
+
+static double bench_parallel(const crc32_kernel_t* k, crc32_many_fn_t many_fn, uint32_t threads, uint64_t total) {
+  uint64_t t0 = now(), elapsed, reps = 0;
+  do {
+    if (crc32_many_parallel(k, many_fn, g_parallel_crcs, g_parallel_bufs, g_parallel_lens, PARALLEL_BUFS, threads, 0)) {
+      FATAL("crc32_many_parallel failed");
+    }
+    ++reps;
+  } while ((elapsed = now() - t0) < g_bench_duration);
+  g_sink = g_parallel_crcs[reps % PARALLEL_BUFS];
+  return (double)(reps * total) / (double)elapsed;
+}
+
+static void bench_parallel_impl(const char* name, crc_fn_t fn, crc32_many_fn_t many_fn) {
+  double rates[64][sizeof(g_bench_sizes) / sizeof(g_bench_sizes[0])];
+  uint32_t counts[64], n_counts = 0, c, r, i;
+  crc32_kernel_t k;
+  crc32_kernel_init(&k, fn);
+  for (c = 1; c < g_parallel_threads; c *= 2) counts[n_counts++] = c;
+  counts[n_counts++] = g_parallel_threads;
+  memset(rates, 0, sizeof(rates));
+  for (i = 0; i < g_bench_size_count; ++i) {
+    uint64_t total = make_parallel_set(g_bench_sizes[i]);
+    if (g_check_correctness) check_parallel(&k, many_fn, g_parallel_threads);
+    for (r = 0; r < g_bench_rounds; ++r) {
+      for (c = 0; c < n_counts; ++c) {
+        double rate = bench_parallel(&k, many_fn, counts[c], total);
+        if (rate > rates[c][i]) rates[c][i] = rate;
+      }
+    }
+  }
+  for (c = 0; c < n_counts; ++c) {
+    printf("%s (%u thread%s)", name, (unsigned)counts[c], counts[c] == 1 ? "" : "s");
+    for (i = 0; i < g_bench_size_count; ++i) {
+      printf("%s%.2f", i ? g_list_sep : g_sep, rates[c][i]);
+    }
+    printf("%s\n", g_gb_suffix);
+    printf("%s (%u thread%s, efficiency)", name, (unsigned)counts[c], counts[c] == 1 ? "" : "s");
+    for (i = 0; i < g_bench_size_count; ++i) {
+      printf("%s%.0f", i ? g_list_sep : g_sep, rates[0][i] ? 100. * rates[c][i] / (counts[c] * rates[0][i]) : 0.);
+    }
+    printf("%s\n", *g_gb_suffix ? "%" : "");
+  }
 }
 
 /* Putting it all together. */
@@ -326,6 +1106,8 @@ static void bench_path(const char* path) {
   void* lib;
   const char* name = path + 2 * (path[0] == '.' && path[1] == '/');
   crc_fn_t fn;
+  column_fn_t column_fn;
+  crc32_many_fn_t many_fn;
   if (colon) {
     char* mut = strdup(path);
     colon = mut + (colon - path);
@@ -334,12 +1116,33 @@ static void bench_path(const char* path) {
     fn_name = colon + 1;
   }
   lib = dlopen(path, RTLD_LAZY | RTLD_LOCAL);
-  if (UNLIKELY(!lib)) FATAL("could not dlopen %s (%s)", path, dlerror());
+  if (UNLIKELY(!lib)) BAD_IMPL("could not dlopen %s (%s)", path, dlerror());
   fn = (crc_fn_t)dlsym(lib, fn_name);
-  if (UNLIKELY(!fn)) FATAL("could not find function %s in %s", fn_name, path);
+  if (!fn && !colon && (g_t10dif.verify = (size_t (*)(const char*, size_t, const char*, size_t, size_t, uint64_t*))dlsym(lib, "t10dif_verify"))) {
+    g_t10dif.sector_size = (size_t (*)(void))dlsym(lib, "t10dif_sector_size");
+    g_t10dif.crc = (uint32_t (*)(uint32_t, const char*, size_t))dlsym(lib, "crc16_t10dif");
+    g_t10dif.generate = (void (*)(const char*, size_t, char*, size_t, size_t))dlsym(lib, "t10dif_generate");
+    if (UNLIKELY(!g_t10dif.sector_size || !g_t10dif.crc || !g_t10dif.generate)) BAD_IMPL("incomplete t10dif functions in %s", path);
+    if (g_check_correctness) check_t10dif(name);
+    fn = t10dif_bench_fn;
+  } else if (UNLIKELY(!fn)) {
+    BAD_IMPL("could not find function %s in %s", fn_name, path);
+  } else if (g_check_correctness) {
+    check_impl(name, fn);
+  }
+  column_fn = colon ? NULL : (column_fn_t)dlsym(lib, "crc32_hash_column");
+  if (column_fn && g_check_correctness) check_column(name, fn, column_fn);
+  if (g_column_mode && !column_fn) BAD_IMPL("could not find function crc32_hash_column in %s", path);
+  many_fn = colon ? NULL : (crc32_many_fn_t)dlsym(lib, "crc32_hash_many");
+  if (many_fn && g_check_correctness) check_many(name, fn, many_fn);
 
-  if (g_check_correctness) check_impl(name, fn);
-  if (g_bench_rounds) bench_impl(name, fn);
+  if (g_bench_rounds && g_column_mode) bench_column_impl(name, fn, column_fn);
+  else if (g_bench_rounds && g_fd_mode && fn != t10dif_bench_fn) bench_fd_impl(name, fn);
+  else if (g_bench_rounds && g_uring_mode && fn != t10dif_bench_fn) bench_uring_impl(name, fn);
+  else if (g_bench_rounds && g_offload_threads && fn != t10dif_bench_fn) bench_offload_impl(name, fn, many_fn);
+  else if (g_bench_rounds && g_parallel_threads && fn != t10dif_bench_fn) bench_parallel_impl(name, fn, many_fn);
+  else if (g_bench_rounds) bench_impl(name, fn);
+  else if (g_report_all) printf("%s%sok\n", name, g_sep);
 
   if (colon) {
     free((char*)path);
@@ -347,13 +1150,6 @@ static void bench_path(const char* path) {
   dlclose(lib);
 }
 
-static void rand_fill(char* buf, size_t n) {
-  size_t i;
-  for (i = 0; i < n; ++i) {
-    buf[i] = rand();
-  }
-}
-
 static void alloc_buf(void) {
   uint32_t size = g_bench_size + 64;
   if (size < g_bench_size) FATAL("buffer size overflow");
@@ -362,7 +1158,16 @@ static void alloc_buf(void) {
   rand_fill(g_buf, size);
 }
 
-static jmp_buf g_catch_signal;
+static const char* read_stdin_path(void) {
+  static char line[4096];
+  while (fgets(line, sizeof(line), stdin)) {
+    size_t n = strlen(line);
+    while (n && (line[n - 1] == '\n' || line[n - 1] == '\r')) line[--n] = '\0';
+    if (n) return line;
+  }
+  return NULL;
+}
+
 static void signal_handler(int signal) {
   longjmp(g_catch_signal, signal);
 }
@@ -379,12 +1184,25 @@ int main(int argc, const char* const* argv) {
   sa.sa_flags = SA_NODEFER;
   sigaction(SIGILL, &sa, NULL);
   sigaction(SIGSEGV, &sa, NULL);
-  for (i = 0; paths[i]; ++i) {
+  for (i = 0; paths[i]; ) {
     const char* path = paths[i];
     int sig;
+    if (!strcmp(path, "-")) {
+      /* Paths from stdin; keep going until EOF. */
+      if (!(path = read_stdin_path())) {
+        ++i;
+        continue;
+      }
+      g_report_all = 1;
+    } else {
+      g_report_all = 0;
+      ++i;
+    }
     if (UNLIKELY(sig = setjmp(g_catch_signal))) {
       const char* what = sig == SIGILL  ? "illegal instruction" :
-                         sig == SIGSEGV ? "segfault" : "signal";
+                         sig == SIGSEGV ? "segfault" :
+                         sig == BAD_IMPL_JMP ? "bad impl" : "signal";
+      stop_handoff();
       if (sig != SIGILL) status = EXIT_FAILURE;
       if (path[0] == '.' && path[1] == '/') path += 2;
       printf("%s%s%s!\n", path, g_sep, what);
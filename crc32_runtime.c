@@ -0,0 +1,855 @@
+/* MIT licensed; see LICENSE.md */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "crc32_runtime.h"
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define HAVE_IO_URING 1
+#endif
+#if __has_include(<linux/futex.h>)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#define HAVE_FUTEX 1
+#endif
+#endif
+
+/* All polynomials here are bit-reflected, with x^0 in the top bit. */
+
+static uint32_t mulmodp(uint32_t a, uint32_t b, uint32_t poly) /* a * b mod P */ {
+  uint32_t m = (uint32_t)1 << 31, p = 0;
+  for (;;) {
+    if (a & m) {
+      p ^= b;
+      if (!(a & (m - 1))) break;
+    }
+    m >>= 1;
+    b = (b >> 1) ^ ((b & 1) * poly);
+  }
+  return p;
+}
+
+void crc32_kernel_init(crc32_kernel_t* k, crc32_fn_t fn) {
+  uint32_t i;
+  k->fn = fn;
+  /* Starting from a zero state (i.e. crc0 of ~0), the single byte 0x80 is
+  ** shifted out after eight steps, leaving exactly P in the state. */
+  k->poly = ~fn(~(uint32_t)0, "\x80", 1);
+  k->x2n[0] = (uint32_t)1 << 30; /* x^1 */
+  for (i = 1; i < 64; ++i) {
+    k->x2n[i] = mulmodp(k->x2n[i - 1], k->x2n[i - 1], k->poly);
+  }
+}
+
+uint32_t crc32_combine(const crc32_kernel_t* k, uint32_t crc_a, uint32_t crc_b, uint64_t len_b) {
+  /* Appending len_b bytes multiplies A's contribution by x^(8 * len_b); the
+  ** pre- and post-inversions of the two halves cancel out. */
+  uint32_t p = (uint32_t)1 << 31; /* x^0 */
+  uint32_t i = 3;
+  for (; len_b; len_b >>= 1, ++i) {
+    if (len_b & 1) p = mulmodp(k->x2n[i & 63], p, k->poly);
+  }
+  return mulmodp(p, crc_a, k->poly) ^ crc_b;
+}
+
+/* io_uring, driven by raw syscalls rather than liburing. */
+
+#if defined(HAVE_IO_URING) && defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+
+typedef struct uring_t {
+  int fd;
+  void* sq_map;
+  void* cq_map;
+  size_t sq_map_size;
+  size_t cq_map_size;
+  struct io_uring_sqe* sqes;
+  size_t sqes_size;
+  uint32_t* sq_tail;
+  uint32_t* sq_mask;
+  uint32_t* sq_array;
+  uint32_t* cq_head;
+  uint32_t* cq_tail;
+  uint32_t* cq_mask;
+  struct io_uring_cqe* cqes;
+  uint32_t to_submit;
+} uring_t;
+
+typedef struct uring_slot_t {
+  char* buf;
+  uint64_t offset; /* of buf[0] within the file */
+  uint32_t len;    /* bytes requested */
+  int32_t res;     /* bytes read, or -errno */
+  int done;
+} uring_slot_t;
+
+static int uring_open(uring_t* r, uint32_t depth) {
+  struct io_uring_params p;
+  memset(&p, 0, sizeof(p));
+  memset(r, 0, sizeof(*r));
+  r->fd = (int)syscall(__NR_io_uring_setup, depth, &p);
+  if (r->fd < 0) return errno == EPERM ? ENOSYS : errno;
+  r->sq_map_size = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+  r->cq_map_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    if (r->cq_map_size > r->sq_map_size) r->sq_map_size = r->cq_map_size;
+    r->cq_map_size = 0;
+  }
+  r->sq_map = mmap(NULL, r->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+  if (r->sq_map == MAP_FAILED) goto fail;
+  r->cq_map = r->sq_map;
+  if (r->cq_map_size) {
+    r->cq_map = mmap(NULL, r->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+    if (r->cq_map == MAP_FAILED) goto fail;
+  }
+  r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+  r->sqes = (struct io_uring_sqe*)mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+  if ((void*)r->sqes == MAP_FAILED) goto fail;
+  r->sq_tail = (uint32_t*)((char*)r->sq_map + p.sq_off.tail);
+  r->sq_mask = (uint32_t*)((char*)r->sq_map + p.sq_off.ring_mask);
+  r->sq_array = (uint32_t*)((char*)r->sq_map + p.sq_off.array);
+  r->cq_head = (uint32_t*)((char*)r->cq_map + p.cq_off.head);
+  r->cq_tail = (uint32_t*)((char*)r->cq_map + p.cq_off.tail);
+  r->cq_mask = (uint32_t*)((char*)r->cq_map + p.cq_off.ring_mask);
+  r->cqes = (struct io_uring_cqe*)((char*)r->cq_map + p.cq_off.cqes);
+  return 0;
+fail: {
+    int err = errno;
+    if (r->sq_map && r->sq_map != MAP_FAILED) munmap(r->sq_map, r->sq_map_size);
+    if (r->cq_map_size && r->cq_map && r->cq_map != MAP_FAILED) munmap(r->cq_map, r->cq_map_size);
+    close(r->fd);
+    return err;
+  }
+}
+
+static void uring_close(uring_t* r) {
+  munmap(r->sqes, r->sqes_size);
+  if (r->cq_map_size) munmap(r->cq_map, r->cq_map_size);
+  munmap(r->sq_map, r->sq_map_size);
+  close(r->fd);
+}
+
+static void uring_read(uring_t* r, int fd, uring_slot_t* s, uint32_t slot) {
+  /* There are never more reads in flight than slots, so the SQ has room. */
+  uint32_t tail = *r->sq_tail;
+  uint32_t idx = tail & *r->sq_mask;
+  struct io_uring_sqe* sqe = &r->sqes[idx];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = IORING_OP_READ;
+  sqe->fd = fd;
+  sqe->off = s->offset;
+  sqe->addr = (uint64_t)(uintptr_t)s->buf;
+  sqe->len = s->len;
+  sqe->user_data = slot;
+  r->sq_array[idx] = idx;
+  s->done = 0;
+  __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+  ++r->to_submit;
+}
+
+static int uring_enter(uring_t* r, uint32_t min_complete) {
+  for (;;) {
+    long n = syscall(__NR_io_uring_enter, r->fd, r->to_submit, min_complete,
+                     min_complete ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    if (n >= 0) {
+      r->to_submit -= (uint32_t)n;
+      return 0;
+    }
+    if (errno != EINTR && errno != EAGAIN) return errno;
+  }
+}
+
+static void uring_reap(uring_t* r, uring_slot_t* slots) {
+  uint32_t head = *r->cq_head;
+  uint32_t tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+  for (; head != tail; ++head) {
+    struct io_uring_cqe* cqe = &r->cqes[head & *r->cq_mask];
+    uring_slot_t* s = &slots[cqe->user_data];
+    s->res = cqe->res;
+    s->done = 1;
+  }
+  __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+}
+
+static uint32_t uring_piece(uint64_t left, size_t buf_size) {
+  /* Read no further than the 4KiB block holding byte size-1 (so O_DIRECT
+  ** reads stay block-sized); anything past size is not hashed. */
+  uint64_t len = (left + 4095) & ~(uint64_t)4095;
+  return (uint32_t)(len < buf_size ? len : buf_size);
+}
+
+int crc32_uring(const crc32_kernel_t* k, int fd, uint64_t size, uint32_t depth, size_t buf_size, uint32_t* crc) {
+  uring_t r;
+  uring_slot_t* slots;
+  char* bufs = NULL;
+  uint64_t next = 0, hashed = 0;
+  uint32_t c = 0, head = 0, i;
+  int err;
+  if (!depth || !buf_size || buf_size > 0x7ffff000u) return EINVAL;
+  if ((err = uring_open(&r, depth))) return err;
+  slots = (uring_slot_t*)calloc(depth, sizeof(uring_slot_t));
+  if (!slots || posix_memalign((void**)&bufs, 4096, depth * buf_size)) {
+    free(slots);
+    uring_close(&r);
+    return ENOMEM;
+  }
+  /* Slot i always holds the (i mod depth)th buffer-sized piece of the file,
+  ** so the kernel consumes slots round-robin, in file order. */
+  for (i = 0; i < depth && next < size; ++i, next += buf_size) {
+    slots[i].buf = bufs + i * buf_size;
+    slots[i].offset = next;
+    slots[i].len = uring_piece(size - next, buf_size);
+    uring_read(&r, fd, &slots[i], i);
+  }
+  while (hashed < size) {
+    uring_slot_t* s = &slots[head];
+    if (!s->done) {
+      if ((err = uring_enter(&r, 1))) break;
+      uring_reap(&r, slots);
+      continue;
+    }
+    if (s->res < 0) {
+      if (s->res == -EINTR || s->res == -EAGAIN) {
+        uring_read(&r, fd, s, head);
+        if ((err = uring_enter(&r, 0))) break;
+        continue;
+      }
+      err = -s->res;
+      break;
+    }
+    if (s->res == 0) {
+      err = EIO; /* The file shrank underneath us. */
+      break;
+    }
+    if ((uint64_t)s->res > size - hashed) s->res = (int32_t)(size - hashed);
+    c = k->fn(c, s->buf, (size_t)s->res);
+    hashed += (uint64_t)s->res;
+    if ((uint32_t)s->res < s->len && hashed < size) {
+      /* Short read: fetch the rest of this piece (into the start of the
+      ** buffer, as what came before has been hashed) before moving on. */
+      s->offset += (uint64_t)s->res;
+      s->len -= (uint32_t)s->res;
+      uring_read(&r, fd, s, head);
+    } else {
+      if (next < size) {
+        s->offset = next;
+        s->len = uring_piece(size - next, buf_size);
+        uring_read(&r, fd, s, head);
+        next += buf_size;
+      }
+      head = head + 1 == depth ? 0 : head + 1;
+    }
+    /* Get the refill going before the kernel runs on the next buffer. */
+    if (r.to_submit && (err = uring_enter(&r, 0))) break;
+  }
+  /* On error, drain anything still in flight before its buffer is freed. */
+  while (err) {
+    for (i = 0; i < depth && (slots[i].done || !slots[i].buf); ++i) {}
+    if (i == depth || uring_enter(&r, 1)) break;
+    uring_reap(&r, slots);
+  }
+  uring_close(&r);
+  free(bufs);
+  free(slots);
+  if (!err) *crc = c;
+  return err;
+}
+
+#else
+
+int crc32_uring(const crc32_kernel_t* k, int fd, uint64_t size, uint32_t depth, size_t buf_size, uint32_t* crc) {
+  (void)k, (void)fd, (void)size, (void)depth, (void)buf_size, (void)crc;
+  return ENOSYS;
+}
+
+#endif
+
+/* crc32_fd: a reader thread and the calling thread, joined by an SPSC ring. */
+
+#define FD_RING_SLOTS 4
+#define FD_RING_BUF_SIZE (64 * 1024) /* default; the whole ring is then 256KiB */
+
+typedef struct fd_ring_t {
+  int fd;
+  int err;          /* written by the reader before it sets done */
+  uint64_t max;
+  size_t buf_size;
+  char* bufs;
+  size_t lens[FD_RING_SLOTS];
+  uint32_t head;    /* buffers consumed; written only by the hashing thread */
+  uint32_t tail;    /* buffers filled; written only by the reader thread */
+  uint32_t done;
+} fd_ring_t;
+
+static void spsc_wait(uint32_t* spins) {
+  /* Spin briefly, then yield, then sleep: a slow pipe or socket shouldn't
+  ** cost a whole core, and on a machine with only one the other side must
+  ** be able to run at all. */
+  if (++*spins < 64) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+  } else if (*spins < 128) {
+    sched_yield();
+  } else {
+    struct timespec ts = {0, 50000};
+    nanosleep(&ts, NULL);
+  }
+}
+
+static void* fd_reader(void* arg) {
+  fd_ring_t* r = (fd_ring_t*)arg;
+  uint64_t total = 0;
+  uint32_t tail = 0, spins = 0;
+  int eof = 0;
+  while (!eof && !r->err && total < r->max) {
+    char* buf;
+    size_t got = 0, want;
+    while (tail - __atomic_load_n(&r->head, __ATOMIC_ACQUIRE) == FD_RING_SLOTS) {
+      spsc_wait(&spins);
+    }
+    spins = 0;
+    buf = r->bufs + (tail % FD_RING_SLOTS) * r->buf_size;
+    want = r->max - total < r->buf_size ? (size_t)(r->max - total) : r->buf_size;
+    /* Fill the whole buffer, as handing over partial ones costs more. */
+    while (got < want) {
+      ssize_t n = read(r->fd, buf + got, want - got);
+      if (n > 0) {
+        got += (size_t)n;
+      } else if (n == 0) {
+        eof = 1;
+        break;
+      } else if (errno != EINTR) {
+        r->err = errno;
+        break;
+      }
+    }
+    if (got) {
+      r->lens[tail % FD_RING_SLOTS] = got;
+      __atomic_store_n(&r->tail, ++tail, __ATOMIC_RELEASE);
+      total += got;
+    }
+  }
+  __atomic_store_n(&r->done, 1, __ATOMIC_RELEASE);
+  return NULL;
+}
+
+int crc32_fd(const crc32_kernel_t* k, int fd, uint64_t max, size_t buf_size, uint32_t* crc, uint64_t* len) {
+  fd_ring_t r;
+  pthread_t reader;
+  uint64_t total = 0;
+  uint32_t c = 0, head = 0, spins = 0;
+  int err;
+  memset(&r, 0, sizeof(r));
+  r.fd = fd;
+  r.max = max;
+  r.buf_size = buf_size ? buf_size : FD_RING_BUF_SIZE;
+  if (!(r.bufs = (char*)malloc(FD_RING_SLOTS * r.buf_size))) return ENOMEM;
+  if ((err = pthread_create(&reader, NULL, fd_reader, &r))) {
+    free(r.bufs);
+    return err;
+  }
+  for (;;) {
+    uint32_t tail = __atomic_load_n(&r.tail, __ATOMIC_ACQUIRE);
+    size_t n;
+    if (head == tail) {
+      /* done is set after the final tail update, so re-check tail after it. */
+      if (__atomic_load_n(&r.done, __ATOMIC_ACQUIRE) && head == __atomic_load_n(&r.tail, __ATOMIC_ACQUIRE)) break;
+      spsc_wait(&spins);
+      continue;
+    }
+    spins = 0;
+    n = r.lens[head % FD_RING_SLOTS];
+    c = k->fn(c, r.bufs + (head % FD_RING_SLOTS) * r.buf_size, n);
+    total += n;
+    __atomic_store_n(&r.head, ++head, __ATOMIC_RELEASE);
+  }
+  pthread_join(reader, NULL);
+  free(r.bufs);
+  if (len) *len = total;
+  if (r.err) return r.err;
+  *crc = c;
+  return 0;
+}
+
+/* crc32_offload: per-thread SPSC rings of jobs, drained by worker threads. */
+/* Ring r is drained only by worker r % workers, so each ring keeps exactly
+** one producer and one consumer, and a submission is one release store. */
+
+#define OFFLOAD_RING_SLOTS 256
+#define OFFLOAD_MAX_RINGS  1024
+#define OFFLOAD_MAX_BATCH  64
+
+struct crc32_offload_ring_t {
+  uint32_t tail;    /* jobs submitted; written only by the submitting thread */
+  char pad0[60];
+  uint32_t head;    /* jobs taken; written only by the ring's worker */
+  char pad1[60];
+  crc32_job_t* slots[OFFLOAD_RING_SLOTS];
+};
+
+typedef struct offload_worker_t {
+  crc32_offload_t* o;
+  pthread_t thread;
+  uint32_t index;
+  int cpu;
+} offload_worker_t;
+
+struct crc32_offload_t {
+  const crc32_kernel_t* k;
+  crc32_many_fn_t many;
+  size_t small_max;
+  uint64_t latency_ns;
+  uint32_t n_workers;
+  uint32_t n_started;
+  uint32_t n_rings;   /* published with release, after rings[n_rings - 1] */
+  uint32_t stop;
+  pthread_mutex_t lock; /* serialises crc32_offload_ring, not submission */
+  offload_worker_t* workers;
+  crc32_offload_ring_t* rings[OFFLOAD_MAX_RINGS];
+};
+
+/* job->done is 0 while pending, 2 once a waiter sleeps on it, then 1. */
+
+static void offload_complete(crc32_job_t* job) {
+#if defined(HAVE_FUTEX)
+  if (__atomic_exchange_n(&job->done, 1, __ATOMIC_RELEASE) == 2) {
+    syscall(SYS_futex, &job->done, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+  }
+#else
+  __atomic_store_n(&job->done, 1, __ATOMIC_RELEASE);
+#endif
+}
+
+int crc32_offload_done(const crc32_job_t* job) {
+  return __atomic_load_n(&job->done, __ATOMIC_ACQUIRE) == 1;
+}
+
+void crc32_offload_wait(crc32_job_t* job) {
+  uint32_t spins = 0;
+  while (__atomic_load_n(&job->done, __ATOMIC_ACQUIRE) != 1) {
+#if defined(HAVE_FUTEX)
+    uint32_t pending = 0;
+    if (++spins < 64) {
+#if defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+#endif
+    } else if (__atomic_compare_exchange_n(&job->done, &pending, 2, 0, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE) || pending == 2) {
+      syscall(SYS_futex, &job->done, FUTEX_WAIT_PRIVATE, 2, NULL, NULL, 0);
+    }
+#else
+    spsc_wait(&spins);
+#endif
+  }
+}
+
+int crc32_offload_submit(crc32_offload_ring_t* ring, crc32_job_t* job) {
+  uint32_t tail = ring->tail;
+  if (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == OFFLOAD_RING_SLOTS) return EAGAIN;
+  job->done = 0;
+  ring->slots[tail % OFFLOAD_RING_SLOTS] = job;
+  __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+  return 0;
+}
+
+static void offload_run(crc32_offload_t* o, crc32_job_t** jobs, uint32_t n) {
+  /* Small jobs first, sorted by length so that the buffers which many hashes
+  ** in lockstep tend to run out together; then large ones, one at a time. */
+  uint32_t crcs[OFFLOAD_MAX_BATCH];
+  const char* bufs[OFFLOAD_MAX_BATCH];
+  size_t lens[OFFLOAD_MAX_BATCH];
+  uint32_t n_small = 0, i, j;
+  for (i = 0; i < n; ++i) {
+    crc32_job_t* job = jobs[i];
+    if (job->len > o->small_max) continue;
+    jobs[i] = jobs[n_small]; /* a large job, unless i == n_small */
+    for (j = n_small; j && jobs[j - 1]->len > job->len; --j) jobs[j] = jobs[j - 1];
+    jobs[j] = job;
+    ++n_small;
+  }
+  if (o->many && n_small > 1) {
+    for (i = 0; i < n_small; ++i) {
+      crcs[i] = jobs[i]->crc;
+      bufs[i] = jobs[i]->buf;
+      lens[i] = jobs[i]->len;
+    }
+    o->many(crcs, bufs, lens, n_small);
+    for (i = 0; i < n_small; ++i) {
+      jobs[i]->crc = crcs[i];
+      offload_complete(jobs[i]);
+    }
+    i = n_small;
+  } else {
+    i = 0;
+  }
+  for (; i < n; ++i) {
+    jobs[i]->crc = o->k->fn(jobs[i]->crc, jobs[i]->buf, jobs[i]->len);
+    offload_complete(jobs[i]);
+  }
+}
+
+static void* offload_worker(void* arg) {
+  offload_worker_t* w = (offload_worker_t*)arg;
+  crc32_offload_t* o = w->o;
+  crc32_job_t* batch[OFFLOAD_MAX_BATCH];
+  uint32_t target = 8, spins = 0, start = 0;
+  uint64_t ns_per_job = 0; /* moving average, in 1/16ths of a nanosecond */
+#if defined(__linux__)
+  if (w->cpu >= 0) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(w->cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  }
+#endif
+  for (;;) {
+    /* stop is read first: anything submitted before it was set is then seen. */
+    uint32_t stop = __atomic_load_n(&o->stop, __ATOMIC_ACQUIRE);
+    uint32_t n_rings = __atomic_load_n(&o->n_rings, __ATOMIC_ACQUIRE);
+    uint32_t n = 0, r, backlog = 0, cap;
+    struct timespec t0, t1;
+    /* Gather up to target jobs, starting from a different ring each time so
+    ** that a busy ring can't starve the others. */
+    for (r = 0; r < n_rings; ++r) {
+      uint32_t ri = (start + r) % n_rings;
+      crc32_offload_ring_t* ring;
+      uint32_t head, tail;
+      if (ri % o->n_workers != w->index) continue;
+      ring = o->rings[ri];
+      head = ring->head;
+      tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+      while (head != tail && n < target) {
+        batch[n++] = ring->slots[head++ % OFFLOAD_RING_SLOTS];
+      }
+      __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+      backlog |= head != tail;
+    }
+    start += n_rings ? 1 : 0;
+    if (!n) {
+      if (stop) break;
+      spsc_wait(&spins);
+      continue;
+    }
+    spins = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    offload_run(o, batch, n);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    {
+      uint64_t ns = (uint64_t)(t1.tv_sec - t0.tv_sec) * 1000000000u + (uint64_t)(t1.tv_nsec - t0.tv_nsec);
+      uint64_t sample = ns * 16 / n;
+      ns_per_job = ns_per_job ? (ns_per_job * 7 + sample) / 8 : sample;
+    }
+    /* A backlog means batches can be bigger; a shallow queue, smaller. */
+    if (backlog && target < OFFLOAD_MAX_BATCH) target *= 2;
+    else if (n * 4 <= target && target > 1) target /= 2;
+    cap = OFFLOAD_MAX_BATCH;
+    if (o->latency_ns && ns_per_job) {
+      uint64_t fit = o->latency_ns * 16 / ns_per_job;
+      cap = fit < 1 ? 1 : fit < OFFLOAD_MAX_BATCH ? (uint32_t)fit : OFFLOAD_MAX_BATCH;
+    }
+    if (target > cap) target = cap;
+  }
+  return NULL;
+}
+
+int crc32_offload_start(crc32_offload_t** out, const crc32_kernel_t* k, crc32_many_fn_t many, size_t small_max,
+                        uint32_t workers, const int* cpus, uint32_t latency_us) {
+  crc32_offload_t* o;
+  uint32_t i;
+  int err = 0;
+  if (!workers) return EINVAL;
+  if (!(o = (crc32_offload_t*)calloc(1, sizeof(*o)))) return ENOMEM;
+  if (!(o->workers = (offload_worker_t*)calloc(workers, sizeof(*o->workers)))) {
+    free(o);
+    return ENOMEM;
+  }
+  o->k = k;
+  o->many = many;
+  o->small_max = small_max ? small_max : 512;
+  o->latency_ns = (uint64_t)latency_us * 1000u;
+  o->n_workers = workers;
+  pthread_mutex_init(&o->lock, NULL);
+  for (i = 0; i < workers; ++i) {
+    offload_worker_t* w = o->workers + i;
+    w->o = o;
+    w->index = i;
+    w->cpu = cpus ? cpus[i] : -1;
+    if ((err = pthread_create(&w->thread, NULL, offload_worker, w))) break;
+    o->n_started = i + 1;
+  }
+  if (err) {
+    /* Workers share the engine, so the ones which did start must exit first. */
+    crc32_offload_stop(o);
+    return err;
+  }
+  *out = o;
+  return 0;
+}
+
+int crc32_offload_ring(crc32_offload_t* o, crc32_offload_ring_t** ring) {
+  crc32_offload_ring_t* r;
+  int err = 0;
+  if (posix_memalign((void**)&r, 64, sizeof(*r))) return ENOMEM;
+  memset(r, 0, sizeof(*r));
+  pthread_mutex_lock(&o->lock);
+  if (o->n_rings == OFFLOAD_MAX_RINGS) {
+    err = ENOSPC;
+  } else {
+    o->rings[o->n_rings] = r;
+    __atomic_store_n(&o->n_rings, o->n_rings + 1, __ATOMIC_RELEASE);
+  }
+  pthread_mutex_unlock(&o->lock);
+  if (err) {
+    free(r);
+    return err;
+  }
+  *ring = r;
+  return 0;
+}
+
+void crc32_offload_stop(crc32_offload_t* o) {
+  uint32_t i;
+  __atomic_store_n(&o->stop, 1, __ATOMIC_RELEASE);
+  for (i = 0; i < o->n_started; ++i) {
+    pthread_join(o->workers[i].thread, NULL);
+  }
+  for (i = 0; i < o->n_rings; ++i) {
+    free(o->rings[i]);
+  }
+  pthread_mutex_destroy(&o->lock);
+  free(o->workers);
+  free(o);
+}
+
+/* crc32_many_parallel: leaves of work, on Chase-Lev work-stealing deques. */
+/* A leaf is either one chunk of a large buffer, or a run of consecutive
+** small buffers of at most one chunk in total. Each thread starts with a
+** contiguous range of leaves on its own deque; it repeatedly takes the range
+** at the bottom, pushes its upper half back, and so on down to one leaf, so
+** the ranges left at the top of its deque (which are what thieves steal)
+** are always the largest. Chunks are folded into their buffer's crc by
+** crc32_combine once every leaf is done. */
+
+#define MANY_DEQUE_SLOTS 64 /* > log2 of the number of leaves */
+
+typedef struct many_leaf_t {
+  size_t buf;       /* index of the (first) buffer */
+  size_t count;     /* buffers in a run, or 0 for a chunk of bufs[buf] */
+  uint64_t offset;  /* of a chunk, within bufs[buf] */
+  size_t len;       /* of a chunk */
+  uint32_t crc;     /* of a chunk, as fn(0, chunk) */
+} many_leaf_t;
+
+typedef struct many_deque_t {
+  int64_t top;      /* advanced by thieves, and by the owner taking the last range */
+  char pad0[56];
+  int64_t bottom;   /* written only by the owner */
+  char pad1[56];
+  uint64_t slots[MANY_DEQUE_SLOTS]; /* ranges of leaves, as lo << 32 | hi */
+} many_deque_t;
+
+typedef struct many_job_t {
+  const crc32_kernel_t* k;
+  crc32_many_fn_t many;
+  uint32_t* crcs;
+  const char* const* bufs;
+  const size_t* lens;
+  many_leaf_t* leaves;
+  many_deque_t* deques;
+  uint32_t n_threads;
+  uint32_t leaves_left;
+  int start;        /* 0 until every thread exists, then 1 (go) or -1 (give up) */
+} many_job_t;
+
+typedef struct many_thread_t {
+  many_job_t* job;
+  uint32_t self;
+} many_thread_t;
+
+static void deque_push(many_deque_t* d, uint64_t range) {
+  int64_t b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED);
+  __atomic_store_n(&d->slots[b % MANY_DEQUE_SLOTS], range, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+}
+
+static int deque_take(many_deque_t* d, uint64_t* range) {
+  int64_t b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED) - 1, t;
+  int ok = 1;
+  __atomic_store_n(&d->bottom, b, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  t = __atomic_load_n(&d->top, __ATOMIC_RELAXED);
+  if (t > b) {
+    __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+    return 0;
+  }
+  *range = __atomic_load_n(&d->slots[b % MANY_DEQUE_SLOTS], __ATOMIC_RELAXED);
+  if (t == b) {
+    /* The last range: race any thieves for it. */
+    ok = __atomic_compare_exchange_n(&d->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+    __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+  }
+  return ok;
+}
+
+static int deque_steal(many_deque_t* d, uint64_t* range) {
+  int64_t t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE), b;
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  b = __atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE);
+  if (t >= b) return 0;
+  *range = __atomic_load_n(&d->slots[t % MANY_DEQUE_SLOTS], __ATOMIC_RELAXED);
+  return __atomic_compare_exchange_n(&d->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+static void many_leaf(many_job_t* j, many_leaf_t* leaf) {
+  size_t i = leaf->buf;
+  if (!leaf->count) {
+    leaf->crc = j->k->fn(0, j->bufs[i] + leaf->offset, leaf->len);
+  } else if (j->many) {
+    j->many(j->crcs + i, j->bufs + i, j->lens + i, leaf->count);
+  } else {
+    for (; i < leaf->buf + leaf->count; ++i) {
+      j->crcs[i] = j->k->fn(j->crcs[i], j->bufs[i], j->lens[i]);
+    }
+  }
+}
+
+static void* many_worker(void* arg) {
+  many_thread_t* t = (many_thread_t*)arg;
+  many_job_t* j = t->job;
+  many_deque_t* d = j->deques + t->self;
+  uint32_t victim = t->self, spins = 0;
+  int start;
+  while (!(start = __atomic_load_n(&j->start, __ATOMIC_ACQUIRE))) spsc_wait(&spins);
+  if (start < 0) return NULL;
+  spins = 0;
+  while (__atomic_load_n(&j->leaves_left, __ATOMIC_ACQUIRE)) {
+    uint64_t range;
+    uint32_t lo, hi, i;
+    int got = deque_take(d, &range);
+    for (i = 1; !got && i < j->n_threads; ++i) {
+      victim = (victim + 1) % j->n_threads;
+      if (victim != t->self) got = deque_steal(j->deques + victim, &range);
+    }
+    if (!got) {
+      spsc_wait(&spins);
+      continue;
+    }
+    spins = 0;
+    lo = (uint32_t)(range >> 32);
+    hi = (uint32_t)range;
+    while (hi - lo > 1) {
+      uint32_t mid = lo + (hi - lo) / 2;
+      deque_push(d, (uint64_t)mid << 32 | hi);
+      hi = mid;
+    }
+    many_leaf(j, j->leaves + lo);
+    __atomic_sub_fetch(&j->leaves_left, 1, __ATOMIC_ACQ_REL);
+  }
+  return NULL;
+}
+
+int crc32_many_parallel(const crc32_kernel_t* k, crc32_many_fn_t many, uint32_t* crcs, const char* const* bufs,
+                        const size_t* lens, size_t n, uint32_t threads, size_t chunk) {
+  many_job_t j;
+  many_thread_t* ts;
+  pthread_t* tids;
+  size_t i, n_leaves = 0, run = 0;
+  uint32_t t, started = 1;
+  int err = 0;
+  if (!chunk) chunk = 256 * 1024;
+  if (!threads) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = online > 0 ? (uint32_t)online : 1;
+  }
+  /* Lay out the leaves: counting them first, then filling them in. */
+  for (i = 0; i < n; ++i) {
+    if (lens[i] > chunk) {
+      n_leaves += (lens[i] + chunk - 1) / chunk;
+      run = 0;
+    } else if (run && run + lens[i] <= chunk) {
+      run += lens[i];
+    } else {
+      ++n_leaves;
+      run = lens[i] + !lens[i]; /* non-zero: a run is open */
+    }
+  }
+  if (!n_leaves) return 0;
+  if (n_leaves >= ((size_t)1 << 32)) return EINVAL;
+  memset(&j, 0, sizeof(j));
+  j.k = k;
+  j.many = many;
+  j.crcs = crcs;
+  j.bufs = bufs;
+  j.lens = lens;
+  if (!(j.leaves = (many_leaf_t*)malloc(n_leaves * sizeof(many_leaf_t)))) return ENOMEM;
+  n_leaves = 0;
+  run = 0;
+  for (i = 0; i < n; ++i) {
+    if (lens[i] > chunk) {
+      uint64_t offset;
+      for (offset = 0; offset < lens[i]; offset += chunk) {
+        many_leaf_t* leaf = j.leaves + n_leaves++;
+        leaf->buf = i;
+        leaf->count = 0;
+        leaf->offset = offset;
+        leaf->len = lens[i] - offset < chunk ? (size_t)(lens[i] - offset) : chunk;
+      }
+      run = 0;
+    } else if (run && run + lens[i] <= chunk) {
+      j.leaves[n_leaves - 1].count += 1;
+      run += lens[i];
+    } else {
+      many_leaf_t* leaf = j.leaves + n_leaves++;
+      leaf->buf = i;
+      leaf->count = 1;
+      run = lens[i] + !lens[i];
+    }
+  }
+  if (threads > n_leaves) threads = (uint32_t)n_leaves;
+  j.n_threads = threads;
+  j.leaves_left = (uint32_t)n_leaves;
+  ts = (many_thread_t*)malloc(threads * sizeof(many_thread_t));
+  tids = (pthread_t*)malloc(threads * sizeof(pthread_t));
+  if (!ts || !tids || posix_memalign((void**)&j.deques, 64, threads * sizeof(many_deque_t))) {
+    free(ts);
+    free(tids);
+    free(j.leaves);
+    return ENOMEM;
+  }
+  memset(j.deques, 0, threads * sizeof(many_deque_t));
+  for (t = 0; t < threads; ++t) {
+    ts[t].job = &j;
+    ts[t].self = t;
+    deque_push(j.deques + t, (uint64_t)(n_leaves * t / threads) << 32 | (n_leaves * (t + 1) / threads));
+  }
+  /* The calling thread is thread 0. No thread starts work until all of
+  ** them exist, so that should one fail to start, crcs is still untouched. */
+  for (t = 1; t < threads; ++t) {
+    if ((err = pthread_create(tids + t, NULL, many_worker, ts + t))) break;
+    started = t + 1;
+  }
+  __atomic_store_n(&j.start, err ? -1 : 1, __ATOMIC_RELEASE);
+  if (!err) many_worker(ts);
+  for (t = 1; t < started; ++t) {
+    pthread_join(tids[t], NULL);
+  }
+  for (i = 0; !err && i < n_leaves; ++i) {
+    many_leaf_t* leaf = j.leaves + i;
+    if (!leaf->count) crcs[leaf->buf] = crc32_combine(k, crcs[leaf->buf], leaf->crc, leaf->len);
+  }
+  free(j.deques);
+  free(tids);
+  free(ts);
+  free(j.leaves);
+  return err;
+}
@@ -0,0 +1,98 @@
+/* MIT licensed; see LICENSE.md */
+#ifndef CRC32_RUNTIME_H
+#define CRC32_RUNTIME_H
+
+/* Runtime support for tools built around one generated kernel. */
+/* The kernel is anything with the signature of a generated crc32_impl; its
+** polynomial is recovered by probing it, so the same code serves any POLY. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t (*crc32_fn_t)(uint32_t crc, const char* buf, size_t len);
+
+typedef struct crc32_kernel_t {
+  crc32_fn_t fn;
+  uint32_t poly;     /* bit-reflected, e.g. 0xedb88320 for crc32 */
+  uint32_t x2n[64];  /* x2n[i] is x^(2^i) mod P, bit-reflected */
+} crc32_kernel_t;
+
+void crc32_kernel_init(crc32_kernel_t* k, crc32_fn_t fn);
+
+/* Given crc_a = fn(0, A, len_a) and crc_b = fn(0, B, len_b), returns
+** fn(0, AB, len_a + len_b), in time logarithmic in len_b. */
+uint32_t crc32_combine(const crc32_kernel_t* k, uint32_t crc_a, uint32_t crc_b, uint64_t len_b);
+
+/* Hashes the first size bytes of fd by keeping depth reads of buf_size bytes
+** in flight through io_uring, and running the kernel on each buffer once it
+** and all those before it have arrived. The buffers are page-aligned, so fd
+** may be opened with O_DIRECT (buf_size should then be a multiple of the
+** block size). Returns 0 or an errno value; ENOSYS means no io_uring. */
+int crc32_uring(const crc32_kernel_t* k, int fd, uint64_t size, uint32_t depth, size_t buf_size, uint32_t* crc);
+
+/* Hashes what can be read from fd, up to max bytes or EOF, for when all a
+** caller has is a descriptor (pipe, socket, file). A reader thread fills a
+** lock-free single-producer single-consumer ring of buf_size buffers while
+** the calling thread runs the kernel on full ones, so that the syscall, the
+** copy, and the CRC overlap. A buf_size of 0 means 64KiB, so that the ring
+** of four buffers (256KiB) stays resident in a typical L2. The number of bytes hashed is stored to
+** *len if len is not NULL. Returns 0 or an errno value. */
+int crc32_fd(const crc32_kernel_t* k, int fd, uint64_t max, size_t buf_size, uint32_t* crc, uint64_t* len);
+
+/* The signature of crc32_hash_many, as emitted by ./generate --column=N:
+** crcs[i] = fn(crcs[i], bufs[i], lens[i]) for each i, with N of the n
+** dependency chains in flight at once. */
+typedef void (*crc32_many_fn_t)(uint32_t* crcs, const char* const* bufs, const size_t* lens, size_t n);
+
+/* An offload engine, for when many threads each need CRCs of small buffers.
+** Every submitting thread gets its own lock-free single-producer ring, and a
+** few worker threads (optionally pinned to dedicated CPUs) drain them. Jobs
+** of at most small_max bytes (0 means 512) are hashed in batches by many, if
+** not NULL, and larger ones by k->fn. Each worker grows its batch size while
+** its rings stay non-empty after a batch, shrinks it when they run shallow,
+** and never lets it exceed what it has measured it can hash in latency_us
+** (0 means no target). */
+typedef struct crc32_offload_t crc32_offload_t;
+typedef struct crc32_offload_ring_t crc32_offload_ring_t;
+
+typedef struct crc32_job_t {
+  const char* buf;
+  size_t len;
+  uint32_t crc;   /* crc0 of the kernel on submission; the result on completion */
+  uint32_t done;  /* owned by the engine from submission until completion */
+} crc32_job_t;
+
+/* Starts workers threads, pinning worker i to cpus[i] unless cpus is NULL
+** or cpus[i] is negative. Returns 0 or an errno value. */
+int crc32_offload_start(crc32_offload_t** o, const crc32_kernel_t* k, crc32_many_fn_t many, size_t small_max,
+                        uint32_t workers, const int* cpus, uint32_t latency_us);
+
+/* Creates a ring, to be used by only one submitting thread, and which lasts
+** until crc32_offload_stop. Returns 0, ENOMEM, or ENOSPC after 1024 rings. */
+int crc32_offload_ring(crc32_offload_t* o, crc32_offload_ring_t** ring);
+
+/* Queues job, which must stay alive until it completes. Never blocks; returns
+** EAGAIN if the ring already holds 256 jobs, and 0 otherwise. */
+int crc32_offload_submit(crc32_offload_ring_t* ring, crc32_job_t* job);
+
+/* Polling: non-zero once job->crc holds the result. */
+int crc32_offload_done(const crc32_job_t* job);
+
+/* Blocking: spins briefly, then sleeps on a futex (Linux) until job completes. */
+void crc32_offload_wait(crc32_job_t* job);
+
+/* Completes every job already submitted, then stops the workers and frees
+** the engine and all of its rings. */
+void crc32_offload_stop(crc32_offload_t* o);
+
+/* crcs[i] = k->fn(crcs[i], bufs[i], lens[i]) for each i < n, across threads
+** threads (0 means one per online CPU), for arrays of buffers of any mix of
+** sizes. Buffers longer than chunk bytes (0 means 256KiB) are hashed chunk
+** by chunk and recombined, and runs of consecutive shorter ones are hashed
+** together by many (if not NULL), so that a work-stealing scheduler can keep
+** every thread busy until the end. The calling thread is one of the threads.
+** Returns 0 or an errno value (and then crcs is unchanged). */
+int crc32_many_parallel(const crc32_kernel_t* k, crc32_many_fn_t many, uint32_t* crcs, const char* const* bufs,
+                        const size_t* lens, size_t n, uint32_t threads, size_t chunk);
+
+#endif
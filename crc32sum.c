@@ -0,0 +1,656 @@
+/* MIT licensed; see LICENSE.md */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "crc32_runtime.h"
+
+/* The kernel, as emitted by ./generate (see CRC32SUM_GENERATE in the Makefile). */
+uint32_t crc32_impl(uint32_t crc0, const char* buf, size_t len);
+
+enum {
+  MMAP_SEQUENTIAL, /* mmap, then madvise(MADV_SEQUENTIAL) */
+  MMAP_POPULATE,   /* mmap with MAP_POPULATE */
+  MMAP_PLAIN,      /* mmap without any hints */
+  MMAP_OFF         /* pread into per-thread buffers */
+};
+
+static uint32_t g_threads   = 0;         /* 0 means one per online CPU */
+static uint64_t g_chunk     = 4 << 20;   /* bytes; larger files are split into chunks of this size */
+static uint64_t g_batch     = 1 << 20;   /* bytes; small files are grouped into batches of about this size */
+static int      g_mmap_mode = MMAP_SEQUENTIAL;
+static int      g_tag       = 0;
+static int      g_check     = 0;
+static int      g_quiet     = 0;
+static int      g_status    = 0;
+static int      g_uring     = 0;
+static int      g_direct    = 0;
+static uint32_t g_uring_depth = 8;      /* reads in flight per file, with --uring */
+
+static const char* const g_mmap_modes[] = {"sequential", "populate", "plain", "off", NULL};
+
+static void print_help(FILE* f, const char* self) {
+  if (!self) self = "./crc32sum";
+  fprintf(f, "Usage: %s [OPTION]... [FILE]...\n", self);
+  fprintf(f, "Print or check CRC32 checksums, using all CPUs for large files.\n");
+  fprintf(f, "With no FILE, or when FILE is -, read standard input.\n\n");
+  fprintf(f, "Options:\n");
+  fprintf(f, "  -c, --check        read checksums from the FILEs and check them\n");
+  fprintf(f, "      --tag          create a BSD-style checksum\n");
+  fprintf(f, "  -j, --threads=N    (default: one per online CPU)\n");
+  fprintf(f, "      --chunk=N      split files larger than this (default: %uMiB)\n", (unsigned)(g_chunk >> 20));
+  fprintf(f, "      --batch=N      group smaller files up to this (default: %uMiB)\n", (unsigned)(g_batch >> 20));
+  fprintf(f, "      --mmap=sequential|populate|plain|off\n");
+  fprintf(f, "      --uring        read large files through io_uring, one thread each\n");
+  fprintf(f, "      --direct       open large files with O_DIRECT (implies --mmap=off)\n");
+  fprintf(f, "      --depth=N      reads in flight per file with --uring (default: %u)\n", (unsigned)g_uring_depth);
+  fprintf(f, "\nThe following options are useful only when verifying checksums:\n");
+  fprintf(f, "      --quiet        don't print OK for each successfully verified file\n");
+  fprintf(f, "      --status       don't output anything, status code shows success\n");
+  fprintf(f, "\nOutput is compatible with sha256sum and friends: \"xxxxxxxx  FILE\", or\n");
+  fprintf(f, "\"CRC32 (FILE) = xxxxxxxx\" with --tag.\n");
+  fprintf(f, "\nSee https://github.com/corsix/fast-crc32/\n");
+}
+
+#define FATAL(fmt, ...) \
+  (fprintf(stderr, "FATAL error at %s:%d - " fmt "\n", __FILE__, __LINE__, ## __VA_ARGS__), fflush(stderr), exit(1))
+
+/* Command line parsing. */
+
+typedef struct cli_arg_t {
+  const char* const* spellings;
+  const char* value;
+} cli_arg_t;
+
+static const char* match_spelling(const char* const* spellings, const char* str, size_t n) {
+  const char* spelling;
+  while ((spelling = *spellings++)) {
+    if (strlen(spelling) == n && memcmp(spelling, str, n) == 0) {
+      break;
+    }
+  }
+  return spelling;
+}
+
+static cli_arg_t* match_arg(cli_arg_t** args, const char* str, size_t n) {
+  cli_arg_t* arg;
+  while ((arg = *args++)) {
+    if (match_spelling(arg->spellings, str, n)) {
+      break;
+    }
+  }
+  return arg;
+}
+
+static uint64_t parse_size(const char* value) {
+  uint64_t result = 0;
+  int i = 0;
+  char c;
+  while ((c = value[i++])) {
+    if ('0' <= c && c <= '9') {
+      result = result * 10 + (c - '0');
+    } else {
+      if (c == ' ') {
+        c = value[i++];
+      }
+      if (c == 'k' || c == 'K') result <<= 10;
+      else if (c == 'm' || c == 'M') result <<= 20;
+      else if (c == 'g' || c == 'G') result <<= 30;
+      else if (c) FATAL("invalid size %s", value);
+      if (c) {
+        c = value[i++];
+      }
+      if (c == 'i') {
+        c = value[i++];
+      }
+      if (c == 'b' || c == 'B') {
+        c = value[i++];
+      }
+      if (c) FATAL("invalid size %s", value);
+      break;
+    }
+  }
+  return result;
+}
+
+static int parse_mmap_mode(const char* value) {
+  int i;
+  for (i = 0; g_mmap_modes[i]; ++i) {
+    if (!strcmp(value, g_mmap_modes[i])) return i;
+  }
+  FATAL("unknown mmap mode %s", value);
+}
+
+static const char** parse_args(int argc, const char* const* argv) {
+#define ARGS \
+  DEF_ARG(threads, "-j") \
+  DEF_ARG(chunk, "--chunk") \
+  DEF_ARG(batch, "--batch") \
+  DEF_ARG(mmap, "--mmap") \
+  DEF_ARG(depth, "--depth")
+#define DEF_ARG(name, ...) static const char* name##_spellings[] = {"--" #name, __VA_ARGS__, NULL};
+  ARGS
+#undef DEF_ARG
+#define DEF_ARG(name, ...) cli_arg_t a_##name = {name##_spellings, NULL};
+  ARGS
+#undef DEF_ARG
+#define DEF_ARG(name, ...) &a_##name,
+  cli_arg_t* args[] = { ARGS NULL };
+#undef DEF_ARG
+#undef ARGS
+  const char** paths = (const char**)malloc((argc + 1) * sizeof(const char*));
+  int i, seen_dash_dash = 0, n_paths = 0;
+
+  for (i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    if (arg[0] == '-' && arg[1] && !seen_dash_dash) {
+      if (!strcmp(arg, "--")) seen_dash_dash = 1;
+      else if (!strcmp(arg, "--check") || !strcmp(arg, "-c")) g_check = 1;
+      else if (!strcmp(arg, "--tag")) g_tag = 1;
+      else if (!strcmp(arg, "--quiet")) g_quiet = 1;
+      else if (!strcmp(arg, "--status")) g_status = 1;
+      else if (!strcmp(arg, "--uring")) g_uring = 1;
+      else if (!strcmp(arg, "--direct")) g_direct = 1;
+      else if (!strcmp(arg, "--help") || !strcmp(arg, "-h") || !strcmp(arg, "-?")) {
+        print_help(stdout, argv[0]);
+        exit(0);
+      } else {
+        const char* eq = strchr(arg, '=');
+        size_t n = eq ? (size_t)(eq - arg) : strlen(arg);
+        cli_arg_t* m = match_arg(args, arg, n);
+        if (m) {
+          if (eq) {
+            m->value = eq + 1;
+          } else if (++i < argc) {
+            m->value = argv[i];
+          } else {
+            FATAL("missing value for option %.*s", (int)n, arg);
+          }
+        } else {
+          FATAL("unknown option %.*s", (int)n, arg);
+        }
+      }
+    } else {
+      paths[n_paths++] = arg;
+    }
+  }
+  if (!n_paths) paths[n_paths++] = "-";
+  paths[n_paths] = NULL;
+
+  if (a_threads.value) g_threads = (uint32_t)atoi(a_threads.value);
+  if (a_chunk.value) g_chunk = parse_size(a_chunk.value);
+  if (a_batch.value) g_batch = parse_size(a_batch.value);
+  if (a_mmap.value) g_mmap_mode = parse_mmap_mode(a_mmap.value);
+  if (a_depth.value) g_uring_depth = (uint32_t)atoi(a_depth.value);
+  if (g_direct || g_uring) g_mmap_mode = MMAP_OFF;
+  if (g_direct) g_chunk = (g_chunk + 4095) & ~(uint64_t)4095; /* O_DIRECT offsets must be aligned */
+  if (!g_chunk) FATAL("chunk size must be non-zero");
+  if (g_tag && g_check) FATAL("--tag is meaningless when verifying checksums");
+  return paths;
+}
+
+/* Planning: files become jobs, and jobs are shared out between threads. */
+/* A large file is mapped once and split into chunks, each of which is one
+** job; the per-chunk CRCs are merged afterwards with crc32_combine. Small
+** files would drown in per-job overhead, so several of them form one job. */
+
+typedef struct file_t {
+  const char* name;
+  const char* base;   /* mapping, if the file is split into chunks */
+  uint64_t size;
+  uint32_t first_job; /* if the file is split into chunks */
+  uint32_t crc;
+  uint32_t expected;  /* for --check */
+  int fd;             /* if the file is split into chunks but not mapped */
+  int small;          /* whether the file is part of a batch job */
+  int err;            /* errno, or 0 */
+} file_t;
+
+typedef struct job_t {
+  uint32_t file;
+  uint32_t count;     /* files [file, file + count) for a batch, or 0 for a chunk */
+  uint64_t offset;    /* for a chunk */
+  uint64_t size;      /* bytes: chunk length, or sum of batch file sizes */
+  uint32_t crc;       /* for a chunk */
+} job_t;
+
+static crc32_kernel_t g_kernel;
+static file_t* g_files;
+static uint32_t g_file_count;
+static uint32_t g_file_capacity;
+static job_t* g_jobs;
+static uint32_t g_job_count;
+static uint32_t g_job_capacity;
+static uint32_t g_next_job;
+static uint32_t g_open_batch = ~(uint32_t)0;
+
+static file_t* add_file(const char* name) {
+  file_t* f;
+  if (g_file_count == g_file_capacity) {
+    g_file_capacity = g_file_capacity ? g_file_capacity * 2 : 64;
+    g_files = (file_t*)realloc(g_files, g_file_capacity * sizeof(file_t));
+    if (!g_files) FATAL("out of memory");
+  }
+  f = &g_files[g_file_count++];
+  memset(f, 0, sizeof(*f));
+  f->name = name;
+  f->fd = -1;
+  return f;
+}
+
+static job_t* add_job(void) {
+  job_t* j;
+  if (g_job_count == g_job_capacity) {
+    g_job_capacity = g_job_capacity ? g_job_capacity * 2 : 64;
+    g_jobs = (job_t*)realloc(g_jobs, g_job_capacity * sizeof(job_t));
+    if (!g_jobs) FATAL("out of memory");
+  }
+  j = &g_jobs[g_job_count++];
+  memset(j, 0, sizeof(*j));
+  return j;
+}
+
+static int hash_fd(int fd, uint32_t* crc, char* buf, size_t buf_size) {
+  uint32_t c = 0;
+  for (;;) {
+    ssize_t n = read(fd, buf, buf_size);
+    if (n > 0) {
+      c = crc32_impl(c, buf, (size_t)n);
+    } else if (n == 0) {
+      break;
+    } else if (errno != EINTR) {
+      return errno;
+    }
+  }
+  *crc = c;
+  return 0;
+}
+
+static int hash_path(const char* path, uint32_t* crc, char* buf, size_t buf_size) {
+  int err, fd = open(path, O_RDONLY);
+  if (fd < 0) return errno;
+  err = hash_fd(fd, crc, buf, buf_size);
+  close(fd);
+  return err;
+}
+
+static size_t buf_size(void) {
+  return g_chunk < (1 << 20) ? (size_t)g_chunk : (1 << 20);
+}
+
+static void plan_file(file_t* f) {
+  struct stat st;
+  uint64_t offset;
+  if (!strcmp(f->name, "-")) {
+    /* Nothing to split or share out; hash it here and now, overlapping
+    ** the reads with the CRC. */
+    f->err = crc32_fd(&g_kernel, STDIN_FILENO, ~(uint64_t)0, 0, &f->crc, NULL);
+    return;
+  }
+  if (stat(f->name, &st)) {
+    f->err = errno;
+    return;
+  }
+  if (S_ISDIR(st.st_mode)) {
+    f->err = EISDIR;
+    return;
+  }
+  f->size = (uint64_t)st.st_size;
+  if (!S_ISREG(st.st_mode) || f->size <= g_chunk) {
+    /* Small (or a pipe or device, whose size is unknown): join a batch. */
+    job_t* j = g_open_batch < g_job_count ? &g_jobs[g_open_batch] : NULL;
+    if (!j || j->size + f->size > g_batch) {
+      g_open_batch = g_job_count;
+      j = add_job();
+      j->file = (uint32_t)(f - g_files);
+    }
+    j->count = (uint32_t)(f - g_files) - j->file + 1;
+    j->size += f->size;
+    f->small = 1;
+    return;
+  }
+  if ((f->fd = open(f->name, O_RDONLY | (g_direct ? O_DIRECT : 0))) < 0) {
+    f->err = errno;
+    return;
+  }
+  if (g_mmap_mode != MMAP_OFF) {
+    int flags = MAP_PRIVATE;
+    void* base;
+#ifdef MAP_POPULATE
+    if (g_mmap_mode == MMAP_POPULATE) flags |= MAP_POPULATE;
+#endif
+    base = mmap(NULL, (size_t)f->size, PROT_READ, flags, f->fd, 0);
+    if (base != MAP_FAILED) {
+      if (g_mmap_mode == MMAP_SEQUENTIAL) madvise(base, (size_t)f->size, MADV_SEQUENTIAL);
+      f->base = (const char*)base;
+      close(f->fd);
+      f->fd = -1;
+    }
+    /* Otherwise fall back to pread. */
+  }
+  f->first_job = g_job_count;
+  if (g_uring) {
+    /* One job for the whole file; its reads are overlapped by io_uring. */
+    job_t* j = add_job();
+    j->file = (uint32_t)(f - g_files);
+    j->size = f->size;
+    return;
+  }
+  for (offset = 0; offset < f->size; offset += g_chunk) {
+    job_t* j = add_job();
+    j->file = (uint32_t)(f - g_files);
+    j->offset = offset;
+    j->size = f->size - offset < g_chunk ? f->size - offset : g_chunk;
+  }
+}
+
+/* Execution. */
+
+static void run_chunk(job_t* j, char* buf) {
+  file_t* f = &g_files[j->file];
+  if (f->base) {
+    j->crc = crc32_impl(0, f->base + j->offset, (size_t)j->size);
+    return;
+  }
+  if (g_uring) {
+    int err = crc32_uring(&g_kernel, f->fd, j->size, g_uring_depth, buf_size(), &j->crc);
+    if (err != ENOSYS) {
+      if (err) __atomic_store_n(&f->err, err, __ATOMIC_RELAXED);
+      return;
+    }
+    /* No io_uring here, so fall back to pread. */
+  }
+  {
+    uint64_t done = 0;
+    uint32_t c = 0;
+    while (done < j->size) {
+      /* O_DIRECT wants whole blocks, so may read past the end of the chunk. */
+      size_t want = j->size - done < buf_size() && !g_direct ? (size_t)(j->size - done) : buf_size();
+      ssize_t n = pread(f->fd, buf, want, (off_t)(j->offset + done));
+      if (n > 0) {
+        if ((uint64_t)n > j->size - done) {
+          n = (ssize_t)(j->size - done);
+        } else if (g_direct && (n & 4095) && (uint64_t)n < j->size - done) {
+          /* A short read before the end of the chunk: keep whole blocks, so
+          ** the next O_DIRECT read stays aligned, or if there are none, drop
+          ** O_DIRECT for the rest of this file. */
+          if (n >= 4096) n &= ~(ssize_t)4095;
+          else fcntl(f->fd, F_SETFL, fcntl(f->fd, F_GETFL) & ~O_DIRECT);
+        }
+        c = crc32_impl(c, buf, (size_t)n);
+        done += (uint64_t)n;
+      } else if (n == 0) {
+        /* The file shrank underneath us. */
+        __atomic_store_n(&f->err, EIO, __ATOMIC_RELAXED);
+        break;
+      } else if (errno != EINTR) {
+        __atomic_store_n(&f->err, errno, __ATOMIC_RELAXED);
+        break;
+      }
+    }
+    j->crc = c;
+  }
+}
+
+static void run_batch(job_t* j, char* buf) {
+  uint32_t i;
+  for (i = j->file; i < j->file + j->count; ++i) {
+    file_t* f = &g_files[i];
+    if (f->small) f->err = hash_path(f->name, &f->crc, buf, buf_size());
+  }
+}
+
+static void* worker(void* unused) {
+  char* buf = NULL;
+  (void)unused;
+  /* Page-aligned, as O_DIRECT requires. */
+  if (posix_memalign((void**)&buf, 4096, buf_size())) FATAL("out of memory");
+  for (;;) {
+    uint32_t i = __atomic_fetch_add(&g_next_job, 1, __ATOMIC_RELAXED);
+    job_t* j;
+    if (i >= g_job_count) break;
+    j = &g_jobs[i];
+    if (j->count) run_batch(j, buf);
+    else run_chunk(j, buf);
+  }
+  free(buf);
+  return NULL;
+}
+
+static void run_jobs(void) {
+  uint32_t n = g_threads, i;
+  pthread_t* threads;
+  if (!n) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    n = online > 0 ? (uint32_t)online : 1;
+  }
+  if (n > g_job_count) n = g_job_count;
+  if (n <= 1) {
+    worker(NULL);
+    return;
+  }
+  /* The calling thread is one of the n. */
+  threads = (pthread_t*)malloc((n - 1) * sizeof(pthread_t));
+  for (i = 0; i + 1 < n; ++i) {
+    if (pthread_create(&threads[i], NULL, worker, NULL)) FATAL("could not create thread");
+  }
+  worker(NULL);
+  for (i = 0; i + 1 < n; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+  free(threads);
+}
+
+static void finish_file(file_t* f) {
+  uint32_t i;
+  if (f->small || f->err || !f->size) return;
+  f->crc = g_jobs[f->first_job].crc;
+  for (i = f->first_job + 1; i < g_job_count && g_jobs[i].file == (uint32_t)(f - g_files) && !g_jobs[i].count; ++i) {
+    f->crc = crc32_combine(&g_kernel, f->crc, g_jobs[i].crc, g_jobs[i].size);
+  }
+  if (f->base) munmap((void*)f->base, (size_t)f->size);
+  if (f->fd >= 0) close(f->fd);
+}
+
+/* Output, in the format of sha256sum and friends. */
+
+static const char* tag_name(void) {
+  static char buf[16];
+  switch (g_kernel.poly) {
+  case 0xedb88320u: return "CRC32";
+  case 0x82f63b78u: return "CRC32C";
+  case 0xeb31d82eu: return "CRC32K";
+  }
+  sprintf(buf, "CRC32_%08X", (unsigned)g_kernel.poly);
+  return buf;
+}
+
+static int needs_escape(const char* name) {
+  return strpbrk(name, "\\\n\r") != NULL;
+}
+
+static void put_name(const char* name) {
+  /* Matches the escaping of coreutils; the line then starts with a backslash. */
+  char c;
+  if (!needs_escape(name)) {
+    fputs(name, stdout);
+    return;
+  }
+  while ((c = *name++)) {
+    if (c == '\\') fputs("\\\\", stdout);
+    else if (c == '\n') fputs("\\n", stdout);
+    else if (c == '\r') fputs("\\r", stdout);
+    else putchar(c);
+  }
+}
+
+static int print_sums(void) {
+  int status = EXIT_SUCCESS;
+  uint32_t i;
+  for (i = 0; i < g_file_count; ++i) {
+    file_t* f = &g_files[i];
+    if (f->err) {
+      fflush(stdout);
+      fprintf(stderr, "crc32sum: %s: %s\n", f->name, strerror(f->err));
+      status = EXIT_FAILURE;
+      continue;
+    }
+    if (needs_escape(f->name)) putchar('\\');
+    if (g_tag) {
+      printf("%s (", tag_name());
+      put_name(f->name);
+      printf(") = %08x\n", (unsigned)f->crc);
+    } else {
+      printf("%08x  ", (unsigned)f->crc);
+      put_name(f->name);
+      putchar('\n');
+    }
+  }
+  return status;
+}
+
+/* --check */
+
+static uint32_t g_bad_lines;
+
+static int parse_hex8(const char* s, uint32_t* out) {
+  uint32_t v = 0;
+  int i;
+  for (i = 0; i < 8; ++i) {
+    char c = s[i];
+    if ('0' <= c && c <= '9') v = (v << 4) + (c - '0');
+    else if ('a' <= c && c <= 'f') v = (v << 4) + (c - 'a' + 10);
+    else if ('A' <= c && c <= 'F') v = (v << 4) + (c - 'A' + 10);
+    else return 0;
+  }
+  *out = v;
+  return 1;
+}
+
+static char* unescape(char* name, size_t n) {
+  /* In-place inverse of put_name; returns NULL for an invalid escape. */
+  char* dst = name;
+  size_t i;
+  for (i = 0; i < n; ++i) {
+    char c = name[i];
+    if (c == '\\') {
+      c = ++i < n ? name[i] : '\0';
+      if (c == 'n') c = '\n';
+      else if (c == 'r') c = '\r';
+      else if (c != '\\') return NULL;
+    }
+    *dst++ = c;
+  }
+  *dst = '\0';
+  return name;
+}
+
+static void parse_check_line(char* line, size_t n) {
+  const char* tag = tag_name();
+  size_t tag_len = strlen(tag);
+  int escaped = 0;
+  uint32_t expected;
+  char* name = NULL;
+  while (n && (line[n - 1] == '\n' || line[n - 1] == '\r')) line[--n] = '\0';
+  if (!n) return;
+  if (line[0] == '\\') escaped = 1, ++line, --n;
+  if (n > tag_len + 2 && !memcmp(line, tag, tag_len) && line[tag_len] == ' ' && line[tag_len + 1] == '(') {
+    /* BSD: TAG (NAME) = xxxxxxxx */
+    if (n >= tag_len + 2 + 1 + 12 && !memcmp(line + n - 12, ") = ", 4) && parse_hex8(line + n - 8, &expected)) {
+      name = line + tag_len + 2;
+      n = n - 12 - (tag_len + 2);
+    }
+  } else if (n > 10 && parse_hex8(line, &expected) && line[8] == ' ' && (line[9] == ' ' || line[9] == '*')) {
+    /* GNU: xxxxxxxx  NAME, or xxxxxxxx *NAME */
+    name = line + 10;
+    n -= 10;
+  }
+  if (name && escaped) name = unescape(name, n);
+  else if (name) name[n] = '\0';
+  if (!name || !*name) {
+    ++g_bad_lines;
+    return;
+  }
+  add_file(strdup(name))->expected = expected;
+}
+
+static void read_check_file(const char* path) {
+  FILE* f = strcmp(path, "-") ? fopen(path, "r") : stdin;
+  char* line = NULL;
+  size_t cap = 0;
+  ssize_t n;
+  if (!f) {
+    fprintf(stderr, "crc32sum: %s: %s\n", path, strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  while ((n = getline(&line, &cap, f)) >= 0) {
+    parse_check_line(line, (size_t)n);
+  }
+  free(line);
+  if (f != stdin) fclose(f);
+}
+
+static const char* plural(uint32_t n) {
+  return n == 1 ? "" : "s";
+}
+
+static int print_checks(void) {
+  uint32_t i, unreadable = 0, mismatched = 0;
+  for (i = 0; i < g_file_count; ++i) {
+    file_t* f = &g_files[i];
+    const char* verdict = "OK";
+    if (f->err) {
+      fflush(stdout);
+      fprintf(stderr, "crc32sum: %s: %s\n", f->name, strerror(f->err));
+      verdict = "FAILED open or read";
+      ++unreadable;
+    } else if (f->crc != f->expected) {
+      verdict = "FAILED";
+      ++mismatched;
+    } else if (g_quiet) {
+      continue;
+    }
+    if (g_status) continue;
+    if (needs_escape(f->name)) putchar('\\');
+    put_name(f->name);
+    printf(": %s\n", verdict);
+  }
+  fflush(stdout);
+  if (!g_status) {
+    if (g_bad_lines) fprintf(stderr, "crc32sum: WARNING: %u line%s improperly formatted\n", (unsigned)g_bad_lines, plural(g_bad_lines));
+    if (unreadable) fprintf(stderr, "crc32sum: WARNING: %u listed file%s could not be read\n", (unsigned)unreadable, plural(unreadable));
+    if (mismatched) fprintf(stderr, "crc32sum: WARNING: %u computed checksum%s did NOT match\n", (unsigned)mismatched, plural(mismatched));
+  }
+  if (!g_file_count) {
+    fprintf(stderr, "crc32sum: no properly formatted checksum lines found\n");
+    return EXIT_FAILURE;
+  }
+  return unreadable || mismatched ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int main(int argc, const char* const* argv) {
+  const char** paths = parse_args(argc, argv);
+  uint32_t i;
+  crc32_kernel_init(&g_kernel, crc32_impl);
+  for (i = 0; paths[i]; ++i) {
+    if (g_check) read_check_file(paths[i]);
+    else add_file(paths[i]);
+  }
+  for (i = 0; i < g_file_count; ++i) {
+    plan_file(&g_files[i]);
+  }
+  run_jobs();
+  for (i = 0; i < g_file_count; ++i) {
+    finish_file(&g_files[i]);
+  }
+  return g_check ? print_checks() : print_sums();
+}
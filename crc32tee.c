@@ -0,0 +1,276 @@
+/* MIT licensed; see LICENSE.md */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+#include <errno.h>
+#include <fcntl.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#endif
+
+/* The kernel, as emitted by ./generate (see CRC32SUM_GENERATE in the Makefile). */
+uint32_t crc32_impl(uint32_t crc0, const char* buf, size_t len);
+
+static const char* g_output = NULL; /* NULL means stderr */
+static int         g_quiet  = 0;
+
+static void print_help(FILE* f, const char* self) {
+  if (!self) self = "./crc32tee";
+  fprintf(f, "Usage: %s [OPTION]...\n", self);
+  fprintf(f, "Copy standard input to standard output, and report its CRC32.\n");
+  fprintf(f, "Example: producer | %s -o data.crc | consumer\n\n", self);
+  fprintf(f, "Options:\n");
+  fprintf(f, "  -o, --output=FILE  write the checksum line to FILE (default: stderr)\n");
+  fprintf(f, "      --quiet        don't report throughput on stderr\n");
+  fprintf(f, "\nWhen stdin is a pipe, the payload is forwarded with tee(2) and splice(2),\n");
+  fprintf(f, "so only the one copy which is hashed ever reaches user space.\n");
+  fprintf(f, "\nSee https://github.com/corsix/fast-crc32/\n");
+}
+
+#define FATAL(fmt, ...) \
+  (fprintf(stderr, "FATAL error at %s:%d - " fmt "\n", __FILE__, __LINE__, ## __VA_ARGS__), fflush(stderr), exit(1))
+
+/* Command line parsing. */
+
+typedef struct cli_arg_t {
+  const char* const* spellings;
+  const char* value;
+} cli_arg_t;
+
+static const char* match_spelling(const char* const* spellings, const char* str, size_t n) {
+  const char* spelling;
+  while ((spelling = *spellings++)) {
+    if (strlen(spelling) == n && memcmp(spelling, str, n) == 0) {
+      break;
+    }
+  }
+  return spelling;
+}
+
+static cli_arg_t* match_arg(cli_arg_t** args, const char* str, size_t n) {
+  cli_arg_t* arg;
+  while ((arg = *args++)) {
+    if (match_spelling(arg->spellings, str, n)) {
+      break;
+    }
+  }
+  return arg;
+}
+
+static void parse_args(int argc, const char* const* argv) {
+#define ARGS \
+  DEF_ARG(output, "-o")
+#define DEF_ARG(name, ...) static const char* name##_spellings[] = {"--" #name, __VA_ARGS__, NULL};
+  ARGS
+#undef DEF_ARG
+#define DEF_ARG(name, ...) cli_arg_t a_##name = {name##_spellings, NULL};
+  ARGS
+#undef DEF_ARG
+#define DEF_ARG(name, ...) &a_##name,
+  cli_arg_t* args[] = { ARGS NULL };
+#undef DEF_ARG
+#undef ARGS
+  int i;
+
+  for (i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    if (!strcmp(arg, "--quiet")) g_quiet = 1;
+    else if (!strcmp(arg, "--help") || !strcmp(arg, "-h") || !strcmp(arg, "-?")) {
+      print_help(stdout, argv[0]);
+      exit(0);
+    } else {
+      const char* eq = strchr(arg, '=');
+      size_t n = eq ? (size_t)(eq - arg) : strlen(arg);
+      cli_arg_t* m = match_arg(args, arg, n);
+      if (m) {
+        if (eq) {
+          m->value = eq + 1;
+        } else if (++i < argc) {
+          m->value = argv[i];
+        } else {
+          FATAL("missing value for option %.*s", (int)n, arg);
+        }
+      } else {
+        FATAL("unknown option %.*s", (int)n, arg);
+      }
+    }
+  }
+
+  g_output = a_output.value;
+}
+
+/* Forwarding. */
+/* Each strategy forwards all of stdin to stdout, returns the number of bytes
+** forwarded, and stores the CRC of those bytes to *crc. They return -1 (with
+** errno set) only if nothing has been consumed from stdin yet, in which case
+** a more general strategy can take over. */
+
+#define PIPE_SIZE (1024 * 1024)
+#define BUF_SIZE  (256 * 1024)
+
+static char* g_buf;
+
+static void write_all(int fd, const char* buf, size_t n) {
+  while (n) {
+    ssize_t m = write(fd, buf, n);
+    if (m > 0) buf += m, n -= (size_t)m;
+    else if (errno != EINTR) FATAL("write to stdout failed (%s)", strerror(errno));
+  }
+}
+
+static int64_t forward_copy(uint32_t* crc) {
+  /* The fallback: read, hash, write. */
+  int64_t total = 0;
+  uint32_t c = 0;
+  for (;;) {
+    ssize_t n = read(STDIN_FILENO, g_buf, BUF_SIZE);
+    if (n > 0) {
+      c = crc32_impl(c, g_buf, (size_t)n);
+      write_all(STDOUT_FILENO, g_buf, (size_t)n);
+      total += n;
+    } else if (n == 0) {
+      break;
+    } else if (errno != EINTR) {
+      FATAL("read from stdin failed (%s)", strerror(errno));
+    }
+  }
+  *crc = c;
+  return total;
+}
+
+#if defined(__linux__)
+
+static int64_t forward_tee(uint32_t* crc) {
+  /* stdin is a pipe: tee(2) duplicates its pages into a private pipe, then
+  ** splice(2) moves the originals to stdout. Only the duplicate is read into
+  ** user space, into an L2-sized buffer, and it is never written back out. */
+  int64_t total = 0;
+  uint32_t c = 0;
+  int dup[2];
+  if (pipe(dup)) return -1;
+  fcntl(dup[1], F_SETPIPE_SZ, PIPE_SIZE);
+  fcntl(STDIN_FILENO, F_SETPIPE_SZ, PIPE_SIZE);
+  for (;;) {
+    ssize_t n = tee(STDIN_FILENO, dup[1], PIPE_SIZE, 0), left;
+    if (n == 0) break;
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      if (total == 0) goto fallback;
+      FATAL("tee from stdin failed (%s)", strerror(errno));
+    }
+    for (left = n; left; ) {
+      ssize_t m = splice(STDIN_FILENO, NULL, STDOUT_FILENO, NULL, (size_t)left, SPLICE_F_MOVE | SPLICE_F_MORE);
+      if (m > 0) left -= m;
+      else if (m < 0 && errno == EINVAL && total == 0 && left == n) {
+        /* stdout can't be spliced to; nothing has left stdin yet. */
+        goto fallback;
+      } else if (m < 0 && errno != EINTR) {
+        FATAL("splice to stdout failed (%s)", strerror(errno));
+      }
+    }
+    for (left = n; left; ) {
+      ssize_t m = read(dup[0], g_buf, left < BUF_SIZE ? (size_t)left : BUF_SIZE);
+      if (m > 0) {
+        c = crc32_impl(c, g_buf, (size_t)m);
+        left -= m;
+      } else if (m < 0 && errno != EINTR) {
+        FATAL("read from pipe failed (%s)", strerror(errno));
+      }
+    }
+    total += n;
+  }
+  close(dup[0]);
+  close(dup[1]);
+  *crc = c;
+  return total;
+fallback:
+  close(dup[0]);
+  close(dup[1]);
+  return -1;
+}
+
+static sigjmp_buf g_catch_sigbus;
+static void sigbus_handler(int signal) {
+  siglongjmp(g_catch_sigbus, signal);
+}
+
+static int64_t forward_file(uint32_t* crc) {
+  /* stdin is a regular file: hash a mapping of it, and sendfile(2) it out. */
+  /* If the file shrinks meanwhile, touching the mapping past its new end */
+  /* raises SIGBUS, and sendfile(2) stops short; either is fatal, as the */
+  /* CRC would no longer match what was written. */
+  struct stat st;
+  const char* base;
+  off_t start, offset, size;
+  if (fstat(STDIN_FILENO, &st) || !S_ISREG(st.st_mode)) return -1;
+  if ((start = offset = lseek(STDIN_FILENO, 0, SEEK_CUR)) < 0) return -1;
+  size = st.st_size;
+  if (offset >= size) {
+    *crc = 0;
+    return 0;
+  }
+  base = (const char*)mmap(NULL, (size_t)size, PROT_READ, MAP_PRIVATE, STDIN_FILENO, 0);
+  if (base == (const char*)MAP_FAILED) return -1;
+  madvise((void*)base, (size_t)size, MADV_SEQUENTIAL);
+  signal(SIGBUS, sigbus_handler);
+  if (sigsetjmp(g_catch_sigbus, 1)) FATAL("stdin shrank while being read");
+  *crc = crc32_impl(0, base + offset, (size_t)(size - offset));
+  while (offset < size) {
+    ssize_t m = sendfile(STDOUT_FILENO, STDIN_FILENO, &offset, (size_t)(size - offset));
+    if (m == 0) {
+      FATAL("stdin shrank while being read");
+    } else if (m < 0 && (errno == EINVAL || errno == ENOSYS)) {
+      /* stdout can't be sent to; fall back to writing from the mapping. */
+      write_all(STDOUT_FILENO, base + offset, (size_t)(size - offset));
+      offset = size;
+    } else if (m < 0 && errno != EINTR) {
+      FATAL("sendfile to stdout failed (%s)", strerror(errno));
+    }
+  }
+  signal(SIGBUS, SIG_DFL);
+  munmap((void*)base, (size_t)size);
+  lseek(STDIN_FILENO, size, SEEK_SET);
+  return (int64_t)(size - start);
+}
+
+#endif
+
+static uint64_t now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int main(int argc, const char* const* argv) {
+  int64_t total = -1;
+  uint32_t crc = 0;
+  uint64_t t0, elapsed;
+  FILE* out = stderr;
+  parse_args(argc, argv);
+  if (!(g_buf = (char*)malloc(BUF_SIZE))) FATAL("out of memory");
+  t0 = now();
+#if defined(__linux__)
+  total = forward_tee(&crc);
+  if (total < 0) total = forward_file(&crc);
+#endif
+  if (total < 0) total = forward_copy(&crc);
+  elapsed = now() - t0;
+  if (g_output && !(out = fopen(g_output, "w"))) FATAL("could not open %s (%s)", g_output, strerror(errno));
+  fprintf(out, "%08x  -\n", (unsigned)crc);
+  if (out != stderr) fclose(out);
+  if (!g_quiet) {
+    fprintf(stderr, "crc32tee: %llu bytes in %.3fs, %.2f GB/s\n", (unsigned long long)total,
+      (double)elapsed * 1e-9, elapsed ? (double)total / (double)elapsed : 0.);
+  }
+  return EXIT_SUCCESS;
+}
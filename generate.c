@@ -19,6 +19,9 @@ static void print_help(FILE* f, const char* self) {
   fprintf(f, "  -i, --isa=ISA\n");
   fprintf(f, "  -p, --polynomial=POLY\n");
   fprintf(f, "  -a, --algorithm=ALGO\n");
+  fprintf(f, "      --sector=N      (for -p t10dif; default: 512)\n");
+  fprintf(f, "      --column=N      also emit crc32_hash_column and crc32_hash_many,\n");
+  fprintf(f, "                      interleaving N values\n");
   fprintf(f, "\nOutput control:\n");
   fprintf(f, "  -o, --output=FILE\n");
   fprintf(f, "\nPossible values for ISA are:\n");
@@ -27,6 +30,7 @@ static void print_help(FILE* f, const char* self) {
   fprintf(f, "  sse, avx, avx2 (x86_64, using pclmulqdq)\n");
   fprintf(f, "  avx512 (x86_64, using pclmulqdq and vpternlogq)\n");
   fprintf(f, "  avx512_vpclmulqdq (x86_64, using vpclmulqdq and vpternlogq)\n");
+  fprintf(f, "  avx512_vpclmulqdq_gfni (x86_64, as above, plus gf2p8affineqb for sN, N >= 2, bar crc32c)\n");
   fprintf(f, "\nPossible values for POLY include:\n");
   fprintf(f, "  crc32   (0x04C11DB7) - hardware accelerated on aarch64\n");
   fprintf(f, "  crc32c  (0x1EDC6F41) - hardware accelerated on aarch64 and x86_64\n");
@@ -34,12 +38,17 @@ static void print_help(FILE* f, const char* self) {
   fprintf(f, "  crc32k2 (0x32583499)\n");
   fprintf(f, "  crc32q  (0x814141AB)\n");
   fprintf(f, "  or specify any 32-bit polynomial in hexadecimal form\n");
+  fprintf(f, "  t10dif  (0x8BB7) - CRC-16 guard tags of T10 protection information, for\n");
+  fprintf(f, "          sectors of N bytes each followed by an 8-byte tuple; ALGO is vN\n");
   fprintf(f, "\nThe ALGO string consists of multiple phases, separated by underscores.\n");
   fprintf(f, "Each phase can contain (with no spaces inbetween) any mixture of:\n");
   fprintf(f, "  vN[xM] use N vector accumulators, and NxM vector loads per iteration\n");
   fprintf(f, "  sN[xM] use N scalar accumulators, and NxM scalar loads per iteration\n");
   fprintf(f, "  kN     use an outer loop over N bytes\n");
   fprintf(f, "  e      use an end pointer for the (inner) loop condition\n");
+  fprintf(f, "Several ALGO strings can be joined as ALGO/LEN/ALGO/LEN/ALGO..., in which\n");
+  fprintf(f, "case each ALGO is used for lengths from the preceding LEN (inclusive) up\n");
+  fprintf(f, "to the following LEN (exclusive), e.g. s3/312/v4/4096/v9s3x4e\n");
   fprintf(f, "\nSee https://github.com/corsix/fast-crc32/\n");
 }
 
@@ -321,8 +330,15 @@ typedef struct algo_phase_t {
 
 static isa_t g_isa = ISA_NONE;
 static uint32_t g_poly = REV_POLY_CRC32;
-static algo_phase_t* g_algo;
+#define MAX_DISPATCH 16
+static algo_phase_t* g_algos[MAX_DISPATCH]; /* g_algos[i] for lengths >= g_algo_min_len[i]. */
+static uint32_t g_algo_min_len[MAX_DISPATCH];
+static uint32_t g_algo_count = 1;
 static const char* g_out_path;
+static int g_t10dif = 0;
+static uint32_t g_t10dif_sector = 512;
+static uint32_t g_column = 0;
+static int g_gfni = 0; /* Phases with 2 to 8 scalar accumulators use gfni (see crc_gfni), bar crc32c. */
 
 typedef struct cli_arg_t {
   const char* const* spellings;
@@ -356,6 +372,7 @@ static isa_t parse_isa(const char* isa) {
   else if (!strcmp(isa, "sse") || !strcmp(isa, "avx") || !strcmp(isa, "avx2")) return ISA_SSE;
   else if (!strcmp(isa, "avx512")) return ISA_AVX512;
   else if (!strcmp(isa, "avx512_vpclmulqdq")) return ISA_AVX512_VPCLMULQDQ;
+  else if (!strcmp(isa, "avx512_vpclmulqdq_gfni")) return g_gfni = 1, ISA_AVX512_VPCLMULQDQ;
   else FATAL("unknown ISA %s", isa);
 }
 
@@ -459,16 +476,47 @@ static algo_phase_t* parse_algo(const char* value) {
       if (cur->v_load) FATAL("need to specify an ISA to use vector accumulators");
       if (cur->s_acc > 1) FATAL("need to specify an ISA to use more than one scalar accumulator");
     }
+    if (g_gfni && cur->s_acc > 8) {
+      FATAL("algorithm %s has more than 8 scalar accumulators, which is all that gfni can hold", value);
+    }
   }
   return first;
 }
 
+static void parse_dispatch(const char* value) {
+  /* ALGO/LEN/ALGO/LEN/ALGO... selects between algorithms based on length. */
+  char* mut = strdup(value);
+  char* itr = mut;
+  unsigned long long len;
+  g_algo_count = 0;
+  for (;;) {
+    char* slash = strchr(itr, '/');
+    if (slash) *slash = '\0';
+    if (g_algo_count == MAX_DISPATCH) FATAL("too many algorithms in %s", value);
+    g_algos[g_algo_count++] = parse_algo(itr);
+    if (!slash) break;
+    itr = slash + 1;
+    slash = strchr(itr, '/');
+    if (!slash) FATAL("expected algorithm after length in algorithm string %s", value);
+    *slash = '\0';
+    len = strtoull(itr, &itr, 10);
+    g_algo_min_len[g_algo_count] = (uint32_t)len;
+    if (*itr || len > 0xffffffffu || len <= g_algo_min_len[g_algo_count - 1]) {
+      FATAL("expected increasing lengths between algorithms in algorithm string %s", value);
+    }
+    itr = slash + 1;
+  }
+  free(mut);
+}
+
 static void parse_args(int argc, const char* const* argv) {
   sbuf_t* b;
 #define ARGS \
   DEF_ARG(isa, "-i") \
   DEF_ARG(poly, "-p", "--polynomial") \
   DEF_ARG(algo, "-a", "--algorithm") \
+  DEF_ARG(sector, "--sector") \
+  DEF_ARG(column, "--column") \
   DEF_ARG(out, "-o", "--output")
 #define DEF_ARG(name, ...) static const char* name##_spellings[] = {"--" #name, __VA_ARGS__, NULL};
   ARGS
@@ -505,8 +553,21 @@ static void parse_args(int argc, const char* const* argv) {
   }
 
   if (isa.value && *isa.value) g_isa = parse_isa(isa.value);
-  if (poly.value && *poly.value) g_poly = parse_poly(poly.value);
-  if (algo.value && *algo.value) g_algo = parse_algo(algo.value);
+  if (poly.value && !strcmp(poly.value, "t10dif")) g_t10dif = 1;
+  else if (poly.value && *poly.value) g_poly = parse_poly(poly.value);
+  /* crc32c has _mm_crc32_u64, which one gfni step per accumulator can't beat. */
+  if (g_gfni && g_poly == REV_POLY_CRC32C) g_gfni = 0;
+  if (sector.value) {
+    g_t10dif_sector = (uint32_t)strtoul(sector.value, NULL, 10);
+    if (!g_t10dif) FATAL("--sector only applies to -p t10dif");
+    if (g_t10dif_sector < 16 || (g_t10dif_sector & 15)) FATAL("sector size %s is not a multiple of 16", sector.value);
+  }
+  if (algo.value && *algo.value) parse_dispatch(algo.value);
+  if (column.value) {
+    g_column = (uint32_t)strtoul(column.value, NULL, 10);
+    if (!g_column || g_column > 16) FATAL("column interleave %s should be between 1 and 16", column.value);
+    if (g_t10dif) FATAL("--column does not apply to -p t10dif");
+  }
   g_out_path = out.value;
 
   b = g_includes;
@@ -996,16 +1057,104 @@ static void emit_vector_fma(sbuf_t* p1, sbuf_t* p2, uint32_t reg, const char* ad
   }
 }
 
+static void emit_scalar_addr(sbuf_t* b, algo_phase_t* ap, uint32_t i, uint32_t j) {
+  /* Where scalar accumulator j does its load i. */
+  if (i || j) put_lit(b, "(");
+  put_lit(b, "buf");
+  if (j) put_lit(b, " + "), emit_product(b, "klen", j);
+  if (i) put_fmt(b, " + %u", (i / ap->s_acc) * g_scalar_natural_bytes);
+  if (i || j) put_lit(b, ")");
+}
+
+/* GFNI scalar accumulators. */
+/* crc_u64 is a linear map from 64 bits (crc ^ val) to 32 bits, so it splits */
+/* into 8x4 blocks of 8x8 bits, each of which gf2p8affineqb can apply. That */
+/* instruction applies one matrix per 64-bit lane though, so the same byte */
+/* position of up to 8 accumulators shares a lane: crc_gfni transposes so */
+/* that lane 4h+j of permute k holds byte 2k+h of every accumulator, applies */
+/* the block for that byte and output byte j, and then sums the products */
+/* over h and k with exclusive-or before transposing back. */
+
+static uint32_t crc_u64_bitwise(uint64_t val) {
+  uint32_t crc = 0, i;
+  for (i = 0; i < 64; ++i) {
+    crc = (crc >> 1) ^ ((((uint32_t)(val >> i) ^ crc) & 1) * g_poly);
+  }
+  return crc;
+}
+
+static void need_crc_gfni(void) {
+  static int done = 0;
+  sbuf_t* b = g_out;
+  uint32_t k, lane, r, t;
+  if (done) return;
+  done = 1;
+  need_immintrin_h();
+
+  put_lit(b, "static const uint64_t CRC_ALIGN(64) g_crc_gfni[9][8] = {\n");
+  for (k = 0; k < 9; ++k) {
+    put_lit(b, "{");
+    for (lane = 0; lane < 8; ++lane) {
+      uint64_t m = 0;
+      if (k < 4) {
+        /* Matrix for input byte 2k+h, output byte j. */
+        uint32_t pos = k * 2 + (lane >> 2), j = lane & 3;
+        for (t = 0; t < 8; ++t) {
+          uint32_t col = crc_u64_bitwise((uint64_t)1 << (pos * 8 + t)) >> (j * 8);
+          for (r = 0; r < 8; ++r) {
+            m |= (uint64_t)((col >> r) & 1) << ((7 - r) * 8 + t);
+          }
+        }
+      } else {
+        /* Permute indices: byte 2k+h of each lane, or byte j of each lane. */
+        for (r = 0; r < 8; ++r) {
+          uint32_t idx = k < 8 ? r * 8 + (k - 4) * 2 + (lane >> 2) : r < 4 ? r * 8 + lane : 0;
+          m |= (uint64_t)idx << (r * 8);
+        }
+      }
+      put_fmt(b, "0x%x%xull%s", (uint32_t)(m >> 32), (uint32_t)m, lane < 7 ? ", " : k < 8 ? "},\n" : "}\n");
+    }
+  }
+  put_lit(b, "};\n\n");
+
+  put_lit(b, "CRC_AINLINE __m512i crc_gfni(__m512i crc, __m512i val) {\n");
+  put_lit(b,   "__m512i x = _mm512_xor_si512(crc, val), a0, a1, a2, a3;\n");
+  for (k = 0; k < 4; ++k) {
+    put_fmt(b, "a%u = _mm512_permutexvar_epi8(_mm512_load_si512(g_crc_gfni[%u]), x);\n", k, k + 4);
+  }
+  for (k = 0; k < 4; ++k) {
+    put_fmt(b, "a%u = _mm512_gf2p8affine_epi64_epi8(a%u, _mm512_load_si512(g_crc_gfni[%u]), 0);\n", k, k, k);
+  }
+  put_lit(b,   "x = _mm512_xor_si512(_mm512_ternarylogic_epi64(a0, a1, a2, 0x96), a3);\n");
+  put_lit(b,   "x = _mm512_xor_si512(x, _mm512_shuffle_i64x2(x, x, 0x4e));\n");
+  put_lit(b,   "return _mm512_maskz_permutexvar_epi8(0x0f0f0f0f0f0f0f0full, _mm512_load_si512(g_crc_gfni[8]), x);\n");
+  put_lit(b, "}\n\n");
+}
+
 static void emit_scalar_main(sbuf_t* b, algo_phase_t* ap) {
   uint32_t i, j;
+  if (g_gfni && ap->s_acc > 1) {
+    /* Accumulator j is lane j of sg. */
+    need_crc_gfni();
+    for (i = 0; i < ap->s_load; i += ap->s_acc) {
+      put_lit(b, "sg = crc_gfni(sg, _mm512_setr_epi64(");
+      for (j = 0; j < 8; ++j) {
+        if (j) put_lit(b, ", ");
+        if (j < ap->s_acc) {
+          put_lit(b, "*(const uint64_t*)");
+          emit_scalar_addr(b, ap, i, j);
+        } else {
+          put_lit(b, "0");
+        }
+      }
+      put_lit(b, "));\n");
+    }
+    return;
+  }
   for (i = 0; i < ap->s_load; i += ap->s_acc) {
     for (j = 0; j < ap->s_acc; ++j) {
       emit_scalar_fn_mem(b, j, g_scalar_natural_bytes);
-      if (i || j) put_lit(b, "(");
-      put_lit(b, "buf");
-      if (j) put_lit(b, " + "), emit_product(b, "klen", j);
-      if (i) put_fmt(b, " + %u", (i / ap->s_acc) * g_scalar_natural_bytes);
-      if (i || j) put_lit(b, ")");
+      emit_scalar_addr(b, ap, i, j);
       put_lit(b, ");\n");
     }
   }
@@ -1035,11 +1184,11 @@ static void emit_vector_tree_reduce(sbuf_t* b, uint32_t n) {
   }
 }
 
-static void emit_main_fn() {
+static void emit_main_fn(const char* linkage, const char* name, algo_phase_t* algo) {
   sbuf_t* b = sbuf_new();
   algo_phase_t* ap;
   uint32_t current_alignment = g_scalar_natural_bytes;
-  put_lit(b, "CRC_EXPORT uint32_t crc32_impl(uint32_t crc0, const char* buf, size_t len) {\n");
+  put_fmt(b, "%s uint32_t %s(uint32_t crc0, const char* buf, size_t len) {\n", linkage, name);
   put_lit(b,   "crc0 = ~crc0;\n");
   if (current_alignment > 1) {
     need_crc_scalar(1);
@@ -1047,7 +1196,7 @@ static void emit_main_fn() {
     put_fmt(b,   "crc0 = %s(crc0, *buf++);\n", g_scalar1_fn);
     put_lit(b, "}\n");
   }
-  for (ap = g_algo; ap; ap = ap->next) {
+  for (ap = algo; ap; ap = ap->next) {
     if (ap->v_acc && g_vector_bytes > current_alignment) {
       current_alignment = g_vector_bytes;
       put_fmt(b, "%s (((uintptr_t)buf & %u) && len >= %u) {\n",
@@ -1181,6 +1330,10 @@ static void emit_main_fn() {
         if (!kernel_itrs && !ap->use_end_ptr) put_fmt(b, "len -= %u;\n", block_size);
         if (scalar_tail) put_fmt(b, "buf += blk * %u;\n", ap->v_load * g_vector_bytes);
       }
+      if (g_gfni && ap->s_acc > 1) {
+        put_lit(vars, "__m512i sg;\n");
+        put_lit(b, "sg = _mm512_setr_epi64(crc0, 0, 0, 0, 0, 0, 0, 0);\n");
+      }
       if (!kernel_itrs || kernel_itrs != (ap->v_acc != 0)) {
         sbuf_t* loop_cond = sbuf_new();
         put_lit(b, "/* Main loop. */\n");
@@ -1232,6 +1385,12 @@ static void emit_main_fn() {
           emit_scalar_main(b, ap);
           if (scalar_tail) put_fmt(b, "buf += %u;\n", (ap->s_load / ap->s_acc) * g_scalar_natural_bytes);
         }
+        if (g_gfni && ap->s_acc > 1) {
+          put_lit(b, "{ __m256i c = _mm512_cvtepi64_epi32(sg); ");
+          for (i = 0; i < ap->s_acc; ++i) {
+            put_fmt(b, "crc%u = _mm256_extract_epi32(c, %u)%s", i, i, i + 1 < ap->s_acc ? ", " : "; }\n");
+          }
+        }
         /* Shift each scalar accumulator by the number of bytes after it. */
         for (i = 0; i < ap->s_acc; ++i) {
           if ((i + 1) >= ap->s_acc && scalar_tail) {
@@ -1351,6 +1510,314 @@ static void emit_main_fn() {
   put_deferred_sbuf(g_out, b);
 }
 
+static void emit_dispatch_fn(void) {
+  sbuf_t* b = sbuf_new();
+  uint32_t i;
+  char name[32];
+  for (i = 0; i < g_algo_count; ++i) {
+    sprintf(name, "crc32_impl_%u", i);
+    emit_main_fn("static", name, g_algos[i]);
+  }
+  put_lit(b, "CRC_EXPORT uint32_t crc32_impl(uint32_t crc0, const char* buf, size_t len) {\n");
+  for (i = 1; i < g_algo_count; ++i) {
+    put_fmt(b, "if (len < %u) return crc32_impl_%u(crc0, buf, len);\n", g_algo_min_len[i], i - 1);
+  }
+  put_fmt(b, "return crc32_impl_%u(crc0, buf, len);\n", g_algo_count - 1);
+  put_lit(b, "}\n");
+  put_deferred_sbuf(g_out, b);
+}
+
+/* T10-DIF protection information. */
+/* Unlike everything above, the CRC here is 16 bits, and not bit-reflected, so
+** it gets its own (much smaller) generator. Sector data is folded 16 bytes at
+** a time, in the non-reflected domain, using vN accumulators; the sector size
+** is fixed at generation time, so the loop trip counts and every folding
+** constant are too. The final 128 bits go through a byte table. */
+
+#define POLY_T10DIF 0x8BB7
+
+static uint32_t xnmodp16(uint32_t n) /* x^n mod P, for the non-reflected 16-bit P */ {
+  uint32_t r = 1;
+  while (n--) {
+    r <<= 1;
+    if (r & 0x10000) r ^= 0x10000 | POLY_T10DIF;
+  }
+  return r;
+}
+
+static void emit_t10dif_table(sbuf_t* b) {
+  uint32_t i, k;
+  put_lit(b, "static const uint16_t g_t10dif_table[256] = {\n");
+  for (i = 0; i < 256; ) {
+    uint32_t crc = i << 8;
+    for (k = 0; k < 8; ++k) {
+      crc = ((crc << 1) ^ ((crc >> 15) * POLY_T10DIF)) & 0xFFFF;
+    }
+    ++i;
+    put_fmt(b, "0x%x%s", crc, i >= 256 ? "" : i % 8 ? ", " : ",\n");
+  }
+  put_lit(b, "\n};\n\n");
+  put_lit(b, "CRC_AINLINE uint32_t t10dif_u8(uint32_t crc, uint8_t val) {\n");
+  put_lit(b,   "return ((crc << 8) ^ g_t10dif_table[(crc >> 8) ^ val]) & 0xFFFF;\n");
+  put_lit(b, "}\n\n");
+  put_lit(b, "CRC_AINLINE uint32_t t10dif_u64(uint32_t crc, uint64_t val) /* most significant byte first */ {\n");
+  put_lit(b,   "int i;\n");
+  put_lit(b,   "for (i = 56; i >= 0; i -= 8) crc = t10dif_u8(crc, (uint8_t)(val >> i));\n");
+  put_lit(b,   "return crc;\n");
+  put_lit(b, "}\n\n");
+}
+
+static void emit_t10dif_set_k(sbuf_t* b, uint32_t nbits) {
+  /* Folding a 128-bit H:L forward by nbits is H*x^(nbits+64) + L*x^nbits. */
+  uint32_t k_lo = xnmodp16(nbits);
+  uint32_t k_hi = xnmodp16(nbits + 64);
+  if (g_isa == ISA_NEON || g_isa == ISA_NEON_EOR3) {
+    put_fmt(b, "k = vcombine_u64(vcreate_u64(0x%x), vcreate_u64(0x%x));\n", k_lo, k_hi);
+  } else {
+    put_fmt(b, "k = _mm_setr_epi32(0x%x, 0, 0x%x, 0);\n", k_lo, k_hi);
+  }
+}
+
+static void emit_t10dif_vector_fns(sbuf_t* b) {
+  if (g_isa == ISA_NEON || g_isa == ISA_NEON_EOR3) {
+    need_clmul_fn("lo", ISA_NEON_EOR3);
+    need_clmul_fn("hi", ISA_NEON_EOR3);
+    put_lit(b, "CRC_AINLINE uint64x2_t t10dif_load(const char* p) /* as a 128-bit big-endian number */ {\n");
+    put_lit(b,   "uint8x16_t v = vrev64q_u8(vld1q_u8((const uint8_t*)p));\n");
+    put_lit(b,   "return vreinterpretq_u64_u8(vextq_u8(v, v, 8));\n");
+    put_lit(b, "}\n\n");
+    put_lit(b, "CRC_AINLINE uint64x2_t t10dif_fold(uint64x2_t x, uint64x2_t k, uint64x2_t y) {\n");
+    if (g_isa == ISA_NEON_EOR3) {
+      put_lit(b,   "return veor3q_u64(clmul_lo(x, k), clmul_hi(x, k), y);\n");
+    } else {
+      put_lit(b,   "return veorq_u64(veorq_u64(clmul_lo(x, k), clmul_hi(x, k)), y);\n");
+    }
+  } else {
+    need_clmul_fn("lo", ISA_SSE);
+    need_clmul_fn("hi", ISA_SSE);
+    need_nmmintrin_h();
+    put_lit(b, "CRC_AINLINE __m128i t10dif_load(const char* p) /* as a 128-bit big-endian number */ {\n");
+    put_lit(b,   "return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)p),\n");
+    put_lit(b,   "  _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0));\n");
+    put_lit(b, "}\n\n");
+    put_lit(b, "CRC_AINLINE __m128i t10dif_fold(__m128i x, __m128i k, __m128i y) {\n");
+    if (g_isa == ISA_AVX512) {
+      need_immintrin_h();
+      put_lit(b,   "return _mm_ternarylogic_epi64(clmul_lo(x, k), clmul_hi(x, k), y, 0x96);\n");
+    } else {
+      put_lit(b,   "return _mm_xor_si128(_mm_xor_si128(clmul_lo(x, k), clmul_hi(x, k)), y);\n");
+    }
+  }
+  put_lit(b, "}\n\n");
+}
+
+static void emit_t10dif_sector_fn(sbuf_t* b) {
+  uint32_t blocks = g_t10dif_sector / 16;
+  uint32_t n = g_algos[0] && g_algos[0]->v_acc ? g_algos[0]->v_acc : 4;
+  uint32_t itrs, i;
+  int neon = g_isa == ISA_NEON || g_isa == ISA_NEON_EOR3;
+  put_lit(b, "CRC_AINLINE uint32_t t10dif_sector(const char* buf) {\n");
+  if (g_isa == ISA_NONE) {
+    put_lit(b,   "uint32_t crc = 0;\n");
+    put_fmt(b,   "const char* end = buf + %u;\n", g_t10dif_sector);
+    put_lit(b,   "for (; buf != end; ++buf) crc = t10dif_u8(crc, *(const uint8_t*)buf);\n");
+    put_lit(b,   "return crc;\n");
+    put_lit(b, "}\n\n");
+    return;
+  }
+  if (n > blocks) n = blocks;
+  itrs = blocks / n;
+  put_fmt(b,   "%s k, x0", g_vec16_type);
+  for (i = 1; i < n; ++i) put_fmt(b, ", x%u", i);
+  put_lit(b, ";\n");
+  if (itrs > 1) put_lit(b, "size_t i;\n");
+  for (i = 0; i < n; ++i) {
+    put_fmt(b, "x%u = t10dif_load(buf + %u);\n", i, i * 16);
+  }
+  if (itrs > 1) {
+    emit_t10dif_set_k(b, n * 128);
+    put_fmt(b, "for (i = 1; i < %u; ++i) {\n", itrs);
+    put_fmt(b,   "buf += %u;\n", n * 16);
+    for (i = 0; i < n; ++i) {
+      put_fmt(b, "x%u = t10dif_fold(x%u, k, t10dif_load(buf + %u));\n", i, i, i * 16);
+    }
+    put_lit(b, "}\n");
+  }
+  if (n > 1 || blocks > itrs * n) {
+    emit_t10dif_set_k(b, 128);
+  }
+  for (i = 1; i < n; ++i) {
+    put_fmt(b, "x0 = t10dif_fold(x0, k, x%u);\n", i);
+  }
+  for (i = itrs * n; i < blocks; ++i) {
+    put_fmt(b, "x0 = t10dif_fold(x0, k, t10dif_load(buf + %u));\n", (i - (itrs - 1) * n) * 16);
+  }
+  if (neon) {
+    put_lit(b, "return t10dif_u64(t10dif_u64(0, vgetq_lane_u64(x0, 1)), vgetq_lane_u64(x0, 0));\n");
+  } else {
+    put_lit(b, "return t10dif_u64(t10dif_u64(0, _mm_extract_epi64(x0, 1)), _mm_cvtsi128_si64(x0));\n");
+  }
+  put_lit(b, "}\n\n");
+}
+
+static void emit_t10dif(void) {
+  sbuf_t* b = g_out;
+  if (g_algo_count != 1 || (g_algos[0] && (g_algos[0]->s_acc > 1 || g_algos[0]->kernel_size || g_algos[0]->next))) {
+    FATAL("-p t10dif only supports -a vN");
+  }
+  emit_t10dif_table(b);
+  if (g_isa != ISA_NONE) emit_t10dif_vector_fns(b);
+  emit_t10dif_sector_fn(b);
+
+  put_lit(b, "CRC_EXPORT size_t t10dif_sector_size(void) {\n");
+  put_fmt(b,   "return %u;\n", g_t10dif_sector);
+  put_lit(b, "}\n\n");
+
+  put_lit(b, "/* CRC-16/T10-DIF of any buffer; crc is 0 for a fresh computation. */\n");
+  put_lit(b, "CRC_EXPORT uint32_t crc16_t10dif(uint32_t crc, const char* buf, size_t len) {\n");
+  put_lit(b,   "for (; len; --len) crc = t10dif_u8(crc, *(const uint8_t*)buf++);\n");
+  put_lit(b,   "return crc;\n");
+  put_lit(b, "}\n\n");
+
+  put_lit(b, "/* Sector i has its data at data + i * data_stride, and its 8-byte PI tuple\n");
+  put_lit(b, "** at pi + i * pi_stride, whose first two bytes are the big-endian guard tag.\n");
+  put_fmt(b, "** For interleaved sectors, pass data_stride = pi_stride = %u and\n", g_t10dif_sector + 8);
+  put_fmt(b, "** pi = data + %u. */\n\n", g_t10dif_sector);
+
+  put_lit(b, "CRC_EXPORT void t10dif_generate(const char* data, size_t data_stride, char* pi, size_t pi_stride, size_t n) {\n");
+  put_lit(b,   "for (; n; --n, data += data_stride, pi += pi_stride) {\n");
+  put_lit(b,     "uint32_t guard = t10dif_sector(data);\n");
+  put_lit(b,     "pi[0] = (char)(guard >> 8);\n");
+  put_lit(b,     "pi[1] = (char)guard;\n");
+  put_lit(b,   "}\n");
+  put_lit(b, "}\n\n");
+
+  put_lit(b, "/* Sets bit i of the bitmap (of (n + 63) / 64 words, if not NULL) when sector i's\n");
+  put_lit(b, "** guard tag is wrong, and returns the number of such sectors. */\n");
+  put_lit(b, "CRC_EXPORT size_t t10dif_verify(const char* data, size_t data_stride, const char* pi, size_t pi_stride, size_t n, uint64_t* mismatch) {\n");
+  put_lit(b,   "size_t i, bad = 0;\n");
+  put_lit(b,   "for (i = 0; i < n; ++i, data += data_stride, pi += pi_stride) {\n");
+  put_lit(b,     "uint32_t guard = t10dif_sector(data);\n");
+  put_lit(b,     "uint32_t stored = ((uint32_t)(uint8_t)pi[0] << 8) | (uint8_t)pi[1];\n");
+  put_lit(b,     "uint64_t bit = (uint64_t)(guard != stored) << (i & 63);\n");
+  put_lit(b,     "if (mismatch) {\n");
+  put_lit(b,       "if (!(i & 63)) mismatch[i >> 6] = 0;\n");
+  put_lit(b,       "mismatch[i >> 6] |= bit;\n");
+  put_lit(b,     "}\n");
+  put_lit(b,     "bad += guard != stored;\n");
+  put_lit(b,   "}\n");
+  put_lit(b,   "return bad;\n");
+  put_lit(b, "}\n");
+}
+
+/* Column hashing. */
+/* Hashes every value of a string column (Arrow layout: n + 1 offsets into
+** one data buffer). Values are short, so rather than parallelism within a
+** value, g_column values are hashed in lockstep, each with its own scalar
+** dependency chain, for as long as they all have 8 bytes left. The same
+** lockstep also serves crc32_hash_many, over n unrelated buffers. */
+
+static void emit_column_lockstep(sbuf_t* b) {
+  /* Given p, e, and c for each of the g_column values, advances them all by
+  ** 8 bytes at a time, for as long as they all have 8 bytes left. */
+  uint32_t i;
+  put_lit(b, "while (e0 - p0 >= 8");
+  for (i = 1; i < g_column; ++i) put_fmt(b, " && e%u - p%u >= 8", i, i);
+  put_lit(b, ") {\n");
+  put_lit(b,   "uint64_t v0");
+  for (i = 1; i < g_column; ++i) put_fmt(b, ", v%u", i);
+  put_lit(b, ";\n");
+  for (i = 0; i < g_column; ++i) {
+    put_fmt(b, "memcpy(&v%u, p%u, 8);\n", i, i);
+  }
+  for (i = 0; i < g_column; ++i) {
+    put_fmt(b, "c%u = %s(c%u, v%u);\n", i, g_scalar8_fn, i, i);
+  }
+  for (i = 0; i < g_column; ++i) {
+    put_fmt(b, "p%u += 8;\n", i);
+  }
+  put_lit(b, "}\n");
+}
+
+static void emit_column_fn(void) {
+  sbuf_t* b = sbuf_new();
+  uint32_t i;
+  need_crc_scalar(1);
+  need_crc_scalar(4);
+  need_crc_scalar(8);
+  put_lit(g_includes, "#include <string.h>\n");
+
+  put_lit(b, "CRC_AINLINE uint32_t crc_value_tail(uint32_t crc, const char* p, const char* end) {\n");
+  put_lit(b,   "uint64_t v8;\n");
+  put_lit(b,   "uint32_t v4;\n");
+  put_lit(b,   "for (; end - p >= 8; p += 8) {\n");
+  put_lit(b,     "memcpy(&v8, p, 8);\n");
+  put_fmt(b,     "crc = %s(crc, v8);\n", g_scalar8_fn);
+  put_lit(b,   "}\n");
+  put_lit(b,   "if (end - p >= 4) {\n");
+  put_lit(b,     "memcpy(&v4, p, 4);\n");
+  put_fmt(b,     "crc = %s(crc, v4);\n", g_scalar4_fn);
+  put_lit(b,     "p += 4;\n");
+  put_lit(b,   "}\n");
+  put_lit(b,   "for (; p != end; ++p) {\n");
+  put_fmt(b,     "crc = %s(crc, *(const uint8_t*)p);\n", g_scalar1_fn);
+  put_lit(b,   "}\n");
+  put_lit(b,   "return crc;\n");
+  put_lit(b, "}\n\n");
+
+  put_lit(b, "/* out[i] = crc32_impl(0, data + offsets[i], offsets[i + 1] - offsets[i]) */\n");
+  put_lit(b, "CRC_EXPORT void crc32_hash_column(const char* data, const int32_t* offsets, size_t n, uint32_t* out) {\n");
+  put_lit(b,   "size_t i = 0;\n");
+  if (g_column > 1) {
+    put_fmt(b, "for (; i + %u <= n; i += %u) {\n", g_column, g_column);
+    for (i = 0; i < g_column; ++i) {
+      put_fmt(b, "const char* p%u = data + offsets[i + %u];\n", i, i);
+    }
+    for (i = 0; i < g_column; ++i) {
+      put_fmt(b, "const char* e%u = data + offsets[i + %u];\n", i, i + 1);
+    }
+    put_lit(b, "uint32_t c0 = 0xffffffff");
+    for (i = 1; i < g_column; ++i) put_fmt(b, ", c%u = 0xffffffff", i);
+    put_lit(b, ";\n");
+    emit_column_lockstep(b);
+    for (i = 0; i < g_column; ++i) {
+      put_fmt(b, "out[i + %u] = ~crc_value_tail(c%u, p%u, e%u);\n", i, i, i, i);
+    }
+    put_lit(b, "}\n");
+  }
+  put_lit(b,   "for (; i < n; ++i) {\n");
+  put_lit(b,     "out[i] = ~crc_value_tail(0xffffffff, data + offsets[i], data + offsets[i + 1]);\n");
+  put_lit(b,   "}\n");
+  put_lit(b, "}\n\n");
+
+  /* The same, for n unrelated buffers (e.g. a batch of jobs in crc32_offload). */
+  put_lit(b, "/* crcs[i] = crc32_impl(crcs[i], bufs[i], lens[i]) */\n");
+  put_lit(b, "CRC_EXPORT void crc32_hash_many(uint32_t* crcs, const char* const* bufs, const size_t* lens, size_t n) {\n");
+  put_lit(b,   "size_t i = 0;\n");
+  if (g_column > 1) {
+    put_fmt(b, "for (; i + %u <= n; i += %u) {\n", g_column, g_column);
+    for (i = 0; i < g_column; ++i) {
+      put_fmt(b, "const char* p%u = bufs[i + %u];\n", i, i);
+    }
+    for (i = 0; i < g_column; ++i) {
+      put_fmt(b, "const char* e%u = p%u + lens[i + %u];\n", i, i, i);
+    }
+    put_lit(b, "uint32_t c0 = ~crcs[i]");
+    for (i = 1; i < g_column; ++i) put_fmt(b, ", c%u = ~crcs[i + %u]", i, i);
+    put_lit(b, ";\n");
+    emit_column_lockstep(b);
+    for (i = 0; i < g_column; ++i) {
+      put_fmt(b, "crcs[i + %u] = ~crc_value_tail(c%u, p%u, e%u);\n", i, i, i, i);
+    }
+    put_lit(b, "}\n");
+  }
+  put_lit(b,   "for (; i < n; ++i) {\n");
+  put_lit(b,     "crcs[i] = ~crc_value_tail(~crcs[i], bufs[i], bufs[i] + lens[i]);\n");
+  put_lit(b,   "}\n");
+  put_lit(b, "}\n");
+  put_deferred_sbuf(g_out, b);
+}
+
 static FILE* open_output_file(const char* path) {
   if (!path || !*path || !strcmp(path, "-")) {
     return stdout;
@@ -1366,8 +1833,16 @@ int main(int argc, const char* const* argv) {
   g_includes = put_new_sbuf(g_out);
   parse_args(argc, argv);
   emit_standard_preprocessor();
+  if (g_t10dif && g_isa == ISA_AVX512_VPCLMULQDQ) g_isa = ISA_AVX512; /* Sectors fold 16 bytes at a time. */
   init_isa();
-  emit_main_fn();
+  if (g_t10dif) {
+    emit_t10dif();
+  } else if (g_algo_count == 1) {
+    emit_main_fn("CRC_EXPORT", "crc32_impl", g_algos[0]);
+  } else {
+    emit_dispatch_fn();
+  }
+  if (g_column) emit_column_fn();
   flush_sbuf_to(g_out, open_output_file(g_out_path));
   return 0;
 }